@@ -1,61 +1,344 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <mutex>
+#include <thread>
+#include <type_traits>
 
 #ifdef _WIN32
 #include <windows.h>
 #endif
 
-#include "allocation_map.h"
+#include "ahm_fwd.h"
+#include "ahm_policies.h"
+#include "ahm_stats.h"
 #include "simple_array.h"
 
+class AhmTraceRecorder;
+
+#include "allocation_map.h"
+
+#ifndef _WIN32
+#include "mmap_arena.h"
+#include "page_map.h"
+#include "slab_heap.h"
+#include "thread_cache.h"
+#endif
+
+// Podesavanja menadzera (BasicHeapManager::Config).
+struct HeapManagerConfig {
+    size_t heap_count = 4;
+    size_t initial_size_bytes = 0;
+    size_t maximum_size_bytes = 0;
+    // Kapacitet kesa po niti u bajtovima (0 iskljucuje kes).
+    // Kes postoji samo na ne-Windows platformama.
+    size_t thread_cache_bytes = 256 * 1024;
+    // Heap-ovi nad velikim stranicama od 2 MiB (MAP_HUGETLB, a bez
+    // rezervisanih velikih stranica madvise(MADV_HUGEPAGE)). Manje TLB
+    // promasaja za velike radne skupove; samo na ne-Windows platformama.
+    bool huge_pages = false;
+    // Slobodna memorija neaktivna duze od ovoga (ms) vraca se OS-u iz
+    // pozadinske niti (madvise na Linux-u, HeapCompact na Windows-u).
+    // 0 iskljucuje nit; Purge() se tada moze zvati rucno.
+    size_t purge_decay_ms = 0;
+    // Blokovi od large_threshold_bytes navise dobijaju sopstveni mmap region,
+    // koji se pri oslobadjanju vraca OS-u (munmap), pa ne dele segmente sa
+    // manjim blokovima; 0 znaci samo blokove vece od segmenta arene (4 MiB).
+    // Do large_cache_bytes oslobodjenih regiona po heap-u se cuva za sledece
+    // velike blokove (bez mmap/munmap i ponovnih page fault-ova), dok ih purge
+    // ne vrati OS-u. Samo na ne-Windows platformama (HeapAlloc velike blokove
+    // vec uzima direktno sa VirtualAlloc).
+    size_t large_threshold_bytes = 1024 * 1024;
+    size_t large_cache_bytes = 32 * 1024 * 1024;
+    // Ako je zadat, svaka alokacija i oslobadjanje se upisuje u binarni
+    // trag u ovom fajlu (format u ahm_trace.h, reprodukuje ga ahm_replay).
+    // Fajl se mapira u trace_capacity_bytes; visak dogadjaja se samo broji.
+    const char* trace_path = nullptr;
+    size_t trace_capacity_bytes = 1024ull * 1024ull * 1024ull;
+    // Pri kreiranju se poziva WarmUp(initial_size_bytes), pa prvi zahtevi ne
+    // cekaju na page fault-ove. Purge (i decay) i ovu memoriju
+    // vraca OS-u ako ostane neaktivna.
+    bool prefault = false;
+    // U build-u sa AHM_PROFILE destruktor ispisuje profil (WriteProfileReport) na stderr.
+    bool profile_report = true;
+};
+
 // Napredni Heap Manager (AHM) - balansira alokacije preko vise heap-ova.
 // Mapiranje alokacija omogucava da se memorija vrati u heap iz kog je uzeta.
-class AdvancedHeapManager {
+// Zakljucavanje heap-ova, izbor heap-a i metapodaci su politike iz
+// ahm_policies.h; AdvancedHeapManager (ahm_fwd.h) je podrazumevana kombinacija.
+// Kombinacije navedene na dnu fajla su vec instancirane u biblioteci, a za
+// druge (npr. sopstvene politike) treba ukljuciti ahm_impl.h.
+template <typename TLock, typename TBalance, typename TMetadata>
+class BasicHeapManager {
+#ifdef _WIN32
+    static_assert(std::is_same<TMetadata, HashMetadata>::value,
+        "TMetadata: na Windows-u je podrzan samo HashMetadata");
+#else
+    static_assert(std::is_same<TMetadata, PageMapMetadata>::value || std::is_same<TMetadata, HashMetadata>::value,
+        "TMetadata: podrzani su PageMapMetadata i HashMetadata");
+#endif
+
 public:
-    struct Config {
-        size_t heap_count = 4;
-        size_t initial_size_bytes = 0;
-        size_t maximum_size_bytes = 0;
-    };
+    using Config = HeapManagerConfig;
 
-    explicit AdvancedHeapManager(const Config& config);
-    ~AdvancedHeapManager();
+    // Poravnanje koje Malloc vec garantuje (kao HeapAlloc); za veca treba MallocAligned.
+    static constexpr size_t kMinAlignment = 2 * sizeof(void*);
 
-    AdvancedHeapManager(const AdvancedHeapManager&) = delete;
-    AdvancedHeapManager& operator=(const AdvancedHeapManager&) = delete;
+    // Baca std::invalid_argument za neispravna podesavanja (i za purge nit
+    // uz zakljucavanje koje nije thread-safe), a std::runtime_error ako heap
+    // ne moze da se kreira.
+    explicit BasicHeapManager(const Config& config);
+    ~BasicHeapManager();
+
+    BasicHeapManager(const BasicHeapManager&) = delete;
+    BasicHeapManager& operator=(const BasicHeapManager&) = delete;
 
     void* Malloc(size_t size);
+    // Alokacija iz zadatog heap-a, mimo izbora heap-a i kesa niti (npr. za
+    // arene koje svoje blokove drze u jednom heap-u). Oslobadja se obicnim
+    // Free ili FreeHinted; za heap_index >= HeapCount() vraca nullptr.
+    void* MallocOnHeap(size_t heap_index, size_t size);
+    // alignment mora biti stepen dvojke (najvise 4 MiB), inace vraca nullptr.
+    // Blok se oslobadja obicnim Free.
+    void* MallocAligned(size_t size, size_t alignment);
     void Free(void* ptr);
+    // Oslobadjanje uz poznatu velicinu (kao C++14 sized delete): size je
+    // velicina prosledjena Malloc/Calloc/Realloc (ne MallocAligned). Klasa se
+    // racuna iz size, a heap vlasnik cita iz zaglavlja segmenta, pa se mapa
+    // stranica ne cita. Na Windows-u mapa alokacija mora da se azurira, pa je
+    // ovo obican Free. U debug build-u se size proverava.
+    void FreeSized(void* ptr, size_t size);
+    // Oslobadjanje uz heap iz kog je blok uzet; heap se ne trazi ponovo
+    // (klasa bloka se i dalje cita iz mape stranica). U debug build-u se
+    // heap_index proverava.
+    void FreeHinted(void* ptr, size_t heap_index);
+
+    // Kao realloc: nullptr ptr je Malloc, size 0 oslobadja blok i vraca nullptr.
+    // Blok raste u mestu kada je sledeci blok u istom heap-u slobodan, a veliki
+    // blokovi se premestaju pomocu mremap umesto kopiranjem. Mali blok ostaje
+    // u mestu samo ako nova velicina pada u istu klasu, da bi FreeSized vazio.
+    void* Realloc(void* ptr, size_t size);
+    // Kao calloc; sveze mapirana memorija (vec nule) se ne brise ponovo.
+    void* Calloc(size_t count, size_t size);
+
+    // Alocira count blokova iste velicine u out i vraca broj uspesnih
+    // (ostatak out je nullptr). Svaki heap se zakljucava jednom po seriji.
+    size_t MallocBatch(size_t size, size_t count, void** out);
+    // Oslobadja count pokazivaca (nullptr se preskace), grupisano po heap-u vlasniku.
+    void FreeBatch(void** ptrs, size_t count);
+
+    // Broj bajtova koji su stvarno upotrebljivi u bloku (kao malloc_usable_size);
+    // 0 za nullptr i adrese koje AHM ne poznaje.
+    size_t UsableSize(void* ptr);
+
+    // Odmah vraca OS-u svu slobodnu memoriju heap-ova (bez cekanja na decay).
+    // Vraca broj vracenih bajtova; HeapCompact to ne javlja, pa je na Windows-u 0.
+    size_t Purge();
+
+    // Svaki heap unapred mapira bar bytes_per_heap bajtova (kao
+    // initial_size_bytes posle kreiranja), bez ucitavanja stranica. Vraca
+    // false ako neki heap to ne moze (maximum_size_bytes, mmap); mapirano do
+    // tada ostaje. Na Windows-u heap raste alokacijom i oslobadjanjem.
+    bool Reserve(size_t bytes_per_heap);
+    // Reserve, pa se slobodna memorija arene ucitava u memoriju, a slab-ovi
+    // dobijaju jos bytes_per_heap ucitanih bajtova i po jedan slab svake
+    // klase; heap-ovi se obradjuju paralelno (do jedne niti po jezgru). Posle
+    // toga do bytes_per_heap malih i isto toliko vecih blokova po heap-u ne
+    // ceka na mmap ni na page fault-ove. Kes niti se ne puni (pripada nitima),
+    // ali se puni iz vec pripremljenih slab-ova. Na Windows-u je ovo najbolji
+    // pokusaj: heap moze da decommit-uje oslobodjenu memoriju.
+    bool WarmUp(size_t bytes_per_heap);
 
     size_t HeapCount() const;
     size_t AllocatedBytes(size_t heap_index) const;
 
+    // Snimak statistike (ahm_stats.h): brojaci svih niti i heap-ova se
+    // sabiraju tek ovde, pa je poziv skuplji od jedne operacije, ali ne
+    // zaustavlja alokacije.
+    AhmStats GetStats() const;
+
+    // Profil po fazama i cekanje na zakljucavanje (ahm_profile.h); bez build
+    // opcije AHM_PROFILE profil je prazan.
+    AhmProfile GetProfile() const;
+    void WriteProfileReport(std::FILE* out) const;
+
+#ifndef _WIN32
+    // Za pthread_atfork kada je menadzer malloc procesa (kao u glibc-u):
+    // LockForFork pre fork-a zakljucava sve brave koje alokacija moze da
+    // uzme, a UnlockAfterFork ih otkljucava u roditelju i u detetu, pa dete
+    // ne nasledi bravu koju je drzala nit koja u njemu ne postoji.
+    void LockForFork();
+    void UnlockAfterFork();
+#endif
+
 private:
+    // Najvece poravnanje koje MallocAligned podrzava.
+    static constexpr size_t kMaxAlignment = 4 * 1024 * 1024;
+
+#ifdef _WIN32
+    using HeapHandle = HANDLE;
+#else
+    // Na ne-Windows platformama svaki heap je zasebna mmap arena.
+    using HeapHandle = MmapArena*;
+#endif
+
 #ifdef _WIN32
     // Informacije o alokaciji: kom heap-u pripada i kolika je velicina.
     struct AllocationInfo {
         size_t heap_index = 0;
         size_t size_bytes = 0;
+        // Adresa koju je vratio HeapAlloc, ako se razlikuje od kljuca (poravnati blokovi).
+        void* block = nullptr;
     };
+#endif
 
-    // Izaberi heap sa najmanje zauzetih bajtova.
-    size_t SelectHeapIndex() const;
-
-    // Pool heap-ova i pracenje zauzeca po heap-u.
-    SimpleArray<HANDLE> heaps_;
-    SimpleArray<size_t> allocated_bytes_;
-    // Mapa adresa -> info o heap-u radi pravilnog Free.
-    AllocationMap<AllocationInfo> allocations_;
-    mutable std::mutex mutex_;
+    // Heap sa sopstvenim zakljucavanjem. Na Windows-u heap vodi i svoj deo
+    // (shard) mape alokacija; na ostalim platformama vlasnistvo i klasu
+    // velicine daje mapa stranica, mali objekti idu iz slab-ova, a veci iz
+    // arene (velicina u zaglavlju bloka), pa mapa alokacija nije potrebna.
+    // Poravnat na liniju kesa da niti na razlicitim heap-ovima ne dele linije.
+    // Brojac bajtova ima sopstvenu liniju: SelectHeapIndex ga cita bez
+    // zakljucavanja, pa ne sme da deli liniju sa mutex-om koji se stalno menja.
+    // Vrh zauzeca je uz brojac bajtova, a brojaci zakljucavanja uz mutex
+    // (menjaju se pod njim), pa statistika ne dodaje nove linije.
+    struct alignas(64) Heap {
+        alignas(64) std::atomic<size_t> allocated_bytes{0};
+        std::atomic<size_t> peak_bytes{0};
+        alignas(64) TLock mutex;
+        std::atomic<uint64_t> lock_acquisitions{0};
+        std::atomic<uint64_t> contended_locks{0};
+#ifdef AHM_PROFILE
+        LockWaitCounters lock_wait;
+#endif
+        HeapHandle handle = nullptr;
+#ifdef _WIN32
+        AllocationMap<AllocationInfo> allocations;
 #else
-    // Na ne-Windows platformama pratimo samo velicinu radi simetrije API-ja.
-    struct AllocationInfo {
-        size_t size_bytes = 0;
+        SlabHeap* slabs = nullptr;
+        // Blokovi koje su oslobodile niti koje nisu odmah dobile zakljucavanje:
+        // MPSC lista bez zakljucavanja, povezana kroz prvu rec bloka. Prazni je
+        // sledeca nit koja zakljuca heap radi alokacije.
+        alignas(64) std::atomic<void*> remote_frees{nullptr};
+#endif
     };
 
-    AllocationMap<AllocationInfo> allocations_;
-    mutable std::mutex mutex_;
+    // Heap za novu alokaciju, po politici balansiranja.
+    size_t SelectHeapIndex();
+    // Uvecava zauzece heap-a i po potrebi njegov vrh.
+    static void AddAllocatedBytes(Heap& heap, size_t bytes);
+    // Broji javnu alokaciju u brojacima niti (ptr nullptr je neuspela).
+    void CountAllocation(const void* ptr, size_t size);
+#ifdef _WIN32
+#endif
+    // Shard mape u kome se vodi ptr.
+    size_t ShardIndex(void* ptr) const;
+    void DestroyHeaps();
+    // Reserve i (uz populate) WarmUp jednog heap-a.
+    bool WarmUpHeap(size_t heap_index, size_t bytes, bool populate);
+
+    // Tela javnih funkcija bez upisa u trag. Javne funkcije koje se pozivaju
+    // medjusobno (Realloc preko Malloc/Free i sl.) koriste ove, da bi svaki
+    // poziv korisnika bio jedan zapis.
+    void* MallocUntraced(size_t size);
+    void* MallocOnHeapUntraced(size_t heap_index, size_t size);
+    void* MallocAlignedUntraced(size_t size, size_t alignment);
+    void FreeUntraced(void* ptr);
+    void* ReallocUntraced(void* ptr, size_t size);
+    void* CallocUntraced(size_t count, size_t size);
+
+    // Vraca memoriju neaktivnu bar decay_ms u svim heap-ovima.
+    size_t PurgeHeaps(uint64_t now_ms, uint64_t decay_ms);
+    // Telo pozadinske niti: PurgeHeaps cetiri puta po periodu decay_ms.
+    void PurgeLoop(uint64_t decay_ms);
+    void StopPurgeThread();
+
+#ifndef _WIN32
+    // Alokacija i oslobadjanje kada je mutex heap-a vec zakljucan.
+    // size_class je klasa iz mape stranica (0 za blokove iz arene).
+    void* MallocSmall(size_t size_class);
+    void* MallocLocked(size_t heap_index, size_t size);
+    void* MallocSmallLocked(size_t heap_index, size_t size_class);
+    void FreeLocked(size_t heap_index, void* ptr, size_t size_class);
+    // Kao FreeLocked, ali bez umanjenja brojaca (vec umanjen pri odlaganju).
+    void ReleaseLocked(size_t heap_index, void* ptr, size_t size_class);
+
+    // Oslobadjanje bez cekanja: ako je heap zakljucan, blok ide u njegovu listu
+    // udaljenih oslobadjanja (first..last je vec povezan lanac).
+    void FreeToHeap(size_t heap_index, void* ptr, size_t size_class);
+    void PushRemoteFrees(Heap& heap, void* first, void* last);
+    // Vraca u heap sve blokove iz liste udaljenih oslobadjanja (heap je zakljucan).
+    void DrainRemoteFrees(size_t heap_index);
+
+    // Oslobadja blokove iz arene/slab-ova, jednom zakljucavajuci svaki heap
+    // (ili odlazuci celu grupu ako je heap zauzet).
+    void ReleaseBlocks(void** blocks, size_t count);
+
+    // Uz HashMetadata zivi blokovi se vode i u live_shards_: RecordLive upisuje
+    // ptr (i vraca ga), TakeEntry ga izbacuje, a FindEntry samo trazi. Obe
+    // vracaju unos mape stranica, 0 za adresu koja nije ziv blok. Uz
+    // PageMapMetadata RecordLive ne radi nista, a ostale citaju mapu stranica.
+    void* RecordLive(void* ptr);
+    void RecordLiveBatch(void** ptrs, size_t count);
+    uint32_t TakeEntry(void* ptr);
+    // Kao TakeEntry za count pokazivaca (nullptr daje 0), jedno zakljucavanje po shard-u.
+    void TakeEntries(void** ptrs, size_t count, uint32_t* entries);
+    uint32_t FindEntry(void* ptr);
+
+    void* MallocCached(ThreadCache* cache, size_t size_class);
+    void FreeCached(ThreadCache* cache, void* ptr, size_t size_class);
+    // Vraca seriju blokova iz kesa niti u heap-ove (jedno zakljucavanje po heap-u).
+    static void ReleaseCachedBlocks(void* context, void** blocks, size_t count);
 #endif
+
+    SimpleArray<Heap> heaps_;
+    TBalance balance_;
+#ifndef _WIN32
+    // Mapa stranica: adresa -> heap vlasnik i klasa (deli je svih heap_count arena).
+    PageMap* page_map_;
+    // Kontrolni blok keseva po niti (nullptr ako je kes iskljucen).
+    ThreadCacheControl* cache_control_;
+
+    // Shard mape zivih blokova (HashMetadata): adresa -> unos mape stranica.
+    // Brava shard-a je list: pod njom se ne uzima nijedna druga.
+    struct alignas(64) LiveShard {
+        TLock mutex;
+        AllocationMap<uint32_t> blocks;
+    };
+    static constexpr bool kHashMetadata = std::is_same<TMetadata, HashMetadata>::value;
+    // Po jedan shard na heap uz HashMetadata, inace prazno.
+    SimpleArray<LiveShard> live_shards_;
+#endif
+
+    // Trag alokacija (nullptr ako Config::trace_path nije zadat).
+    AhmTraceRecorder* trace_ = nullptr;
+    // Brojaci operacija po niti (GetStats).
+    StatsControl* stats_control_ = nullptr;
+    bool profile_report_ = false;
+
+    // Pozadinska nit za vracanje memorije (samo ako je purge_decay_ms > 0).
+    std::thread purge_thread_;
+    std::mutex purge_mutex_;
+    std::condition_variable purge_wakeup_;
+    bool purge_stop_ = false;
 };
+
+// Kombinacije instancirane u ahm.cpp.
+extern template class BasicHeapManager<std::mutex, LeastBytesBalance>;
+extern template class BasicHeapManager<std::mutex, RoundRobinBalance>;
+extern template class BasicHeapManager<std::mutex, ThreadHashBalance>;
+extern template class BasicHeapManager<SpinLock, LeastBytesBalance>;
+extern template class BasicHeapManager<SpinLock, RoundRobinBalance>;
+extern template class BasicHeapManager<SpinLock, ThreadHashBalance>;
+extern template class BasicHeapManager<NullLock, LeastBytesBalance>;
+extern template class BasicHeapManager<NullLock, RoundRobinBalance>;
+extern template class BasicHeapManager<NullLock, ThreadHashBalance>;
+#ifndef _WIN32
+extern template class BasicHeapManager<std::mutex, LeastBytesBalance, HashMetadata>;
+extern template class BasicHeapManager<SpinLock, LeastBytesBalance, HashMetadata>;
+extern template class BasicHeapManager<NullLock, LeastBytesBalance, HashMetadata>;
+#endif
@@ -0,0 +1,28 @@
+#include "ahm_allocator.h"
+
+#include <stdexcept>
+
+void ahm_detail::CheckAdapterHeap(const AdvancedHeapManager& ahm, size_t heap_index) {
+    if (heap_index >= ahm.HeapCount()) {
+        throw std::invalid_argument("heap_index must be kAnyHeap or less than HeapCount()");
+    }
+}
+
+AhmMemoryResource::AhmMemoryResource(AdvancedHeapManager& ahm, size_t heap_index) : ahm_(ahm), heap_index_(heap_index) {
+    if (heap_index != kAnyHeap) {
+        ahm_detail::CheckAdapterHeap(ahm, heap_index);
+    }
+}
+
+void* AhmMemoryResource::do_allocate(size_t bytes, size_t alignment) {
+    return ahm_detail::AdapterAllocate(ahm_, heap_index_, bytes, alignment);
+}
+
+void AhmMemoryResource::do_deallocate(void* ptr, size_t bytes, size_t alignment) {
+    ahm_detail::AdapterDeallocate(ahm_, ptr, bytes, alignment);
+}
+
+bool AhmMemoryResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    const AhmMemoryResource* resource = dynamic_cast<const AhmMemoryResource*>(&other);
+    return resource && &resource->ahm_ == &ahm_;
+}
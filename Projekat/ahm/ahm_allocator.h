@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+
+#include "ahm.h"
+
+// Adapteri za kontejnere standardne biblioteke nad AHM-om: AhmAllocator<T>
+// (Allocator za std::vector, std::unordered_map, std::basic_string...) i
+// AhmMemoryResource za std::pmr kontejnere.
+//
+// Oba su vezana za menadzer, a opciono i za jedan heap (kAnyHeap bira heap
+// kao obican Malloc, sa kesom niti). Alokacija iz zadatog heap-a ide kroz
+// MallocOnHeap, mimo kesa niti, pa je sporija; korisna je kada kontejner
+// treba da drzi memoriju u heap-u jedne niti ili konekcije. Oslobadjanje
+// koristi FreeSized (kontejner zna velicinu), pa ne cita mapu stranica, a
+// heap vlasnik se cita iz bloka - zato su adapteri nad istim menadzerom
+// jednaki bez obzira na heap. Blokovi sa poravnanjem vecim od kMinAlignment
+// idu kroz MallocAligned (iz bilo kog heap-a) i obican Free.
+// Neuspela alokacija baca std::bad_alloc, kako kontejneri ocekuju.
+
+const size_t kAnyHeap = SIZE_MAX;
+
+namespace ahm_detail {
+// Zajednicki deo AhmAllocator-a i AhmMemoryResource-a.
+inline void* AdapterAllocate(AdvancedHeapManager& ahm, size_t heap_index, size_t bytes, size_t alignment) {
+    void* ptr = nullptr;
+    if (alignment > AdvancedHeapManager::kMinAlignment) {
+        ptr = ahm.MallocAligned(bytes, alignment);
+    } else if (heap_index == kAnyHeap) {
+        ptr = ahm.Malloc(bytes);
+    } else {
+        ptr = ahm.MallocOnHeap(heap_index, bytes);
+    }
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+inline void AdapterDeallocate(AdvancedHeapManager& ahm, void* ptr, size_t bytes, size_t alignment) {
+    if (alignment > AdvancedHeapManager::kMinAlignment) {
+        ahm.Free(ptr);
+    } else {
+        ahm.FreeSized(ptr, bytes);
+    }
+}
+
+// Proverava heap_index kao AhmArena (std::invalid_argument).
+void CheckAdapterHeap(const AdvancedHeapManager& ahm, size_t heap_index);
+}
+
+template <typename T>
+class AhmAllocator {
+public:
+    using value_type = T;
+    // Kontejner nosi alokator sa sobom pri dodeli i zameni, pa memoriju
+    // uvek oslobadja menadzer iz kog je uzeta.
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    // Baca std::invalid_argument ako heap_index nije kAnyHeap niti manji od HeapCount().
+    explicit AhmAllocator(AdvancedHeapManager& ahm, size_t heap_index = kAnyHeap) : ahm_(&ahm), heap_index_(heap_index) {
+        if (heap_index != kAnyHeap) {
+            ahm_detail::CheckAdapterHeap(ahm, heap_index);
+        }
+    }
+
+    template <typename U>
+    AhmAllocator(const AhmAllocator<U>& other) noexcept : ahm_(&other.Manager()), heap_index_(other.HeapIndex()) {}
+
+    T* allocate(size_t count) {
+        if (count > SIZE_MAX / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(ahm_detail::AdapterAllocate(*ahm_, heap_index_, count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* ptr, size_t count) noexcept {
+        ahm_detail::AdapterDeallocate(*ahm_, ptr, count * sizeof(T), alignof(T));
+    }
+
+    AdvancedHeapManager& Manager() const { return *ahm_; }
+    size_t HeapIndex() const { return heap_index_; }
+
+private:
+    AdvancedHeapManager* ahm_;
+    size_t heap_index_;
+};
+
+template <typename T, typename U>
+bool operator==(const AhmAllocator<T>& left, const AhmAllocator<U>& right) noexcept {
+    return &left.Manager() == &right.Manager();
+}
+
+template <typename T, typename U>
+bool operator!=(const AhmAllocator<T>& left, const AhmAllocator<U>& right) noexcept {
+    return !(left == right);
+}
+
+// std::pmr adapter nad menadzerom; za razliku od AhmArenaResource svaki
+// do_deallocate odmah vraca blok menadzeru.
+class AhmMemoryResource : public std::pmr::memory_resource {
+public:
+    // Baca std::invalid_argument ako heap_index nije kAnyHeap niti manji od HeapCount().
+    explicit AhmMemoryResource(AdvancedHeapManager& ahm, size_t heap_index = kAnyHeap);
+
+    AdvancedHeapManager& Manager() const { return ahm_; }
+    size_t HeapIndex() const { return heap_index_; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    AdvancedHeapManager& ahm_;
+    size_t heap_index_;
+};
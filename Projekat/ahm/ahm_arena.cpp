@@ -0,0 +1,164 @@
+#include "ahm_arena.h"
+
+#include "ahm.h"
+
+#include <new>
+#include <stdexcept>
+
+AhmArena::AhmArena(AdvancedHeapManager& ahm, size_t heap_index, size_t chunk_bytes)
+    : ahm_(ahm),
+      heap_index_(heap_index),
+      chunk_bytes_(chunk_bytes),
+      used_(nullptr),
+      free_(nullptr),
+      current_(nullptr),
+      large_(nullptr),
+      cursor_(0),
+      limit_(0),
+      used_bytes_(0),
+      reserved_bytes_(0) {
+    if (heap_index >= ahm.HeapCount()) {
+        throw std::invalid_argument("heap_index must be less than HeapCount()");
+    }
+    if (chunk_bytes < 4 * sizeof(Chunk)) {
+        throw std::invalid_argument("chunk_bytes is too small");
+    }
+}
+
+AhmArena::~AhmArena() {
+    Release();
+}
+
+void* AhmArena::Allocate(size_t size, size_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        return nullptr;
+    }
+    if (size == 0) {
+        size = 1;
+    }
+
+    // Brza putanja: pomeri kursor u tekucem chunk-u.
+    if (current_) {
+        uintptr_t begin = AlignUp(cursor_, alignment);
+        if (begin <= limit_ && size <= limit_ - begin) {
+            used_bytes_ += begin + size - cursor_;
+            cursor_ = begin + size;
+            return reinterpret_cast<void*>(begin);
+        }
+    }
+
+    // Ostatak tekuceg chunk-a se napusta samo za zahteve koji staju u nov
+    // chunk; veliki zahtevi dobijaju poseban blok, a tekuci chunk ostaje.
+    size_t capacity = chunk_bytes_ - sizeof(Chunk);
+    if (size > chunk_bytes_ / 4 || alignment > capacity - size) {
+        return AllocateLarge(size, alignment);
+    }
+    if (!NextChunk()) {
+        return nullptr;
+    }
+    uintptr_t begin = AlignUp(cursor_, alignment);
+    used_bytes_ += begin + size - cursor_;
+    cursor_ = begin + size;
+    return reinterpret_cast<void*>(begin);
+}
+
+void AhmArena::Reset() {
+    FreeChunks(large_);
+    large_ = nullptr;
+
+    // Popunjeni chunk-ovi idu na pocetak liste za ponovnu upotrebu.
+    if (used_) {
+        Chunk* tail = used_;
+        while (tail->next) {
+            tail = tail->next;
+        }
+        tail->next = free_;
+        free_ = used_;
+        used_ = nullptr;
+    }
+    current_ = nullptr;
+    cursor_ = 0;
+    limit_ = 0;
+    used_bytes_ = 0;
+}
+
+void AhmArena::Release() {
+    Reset();
+    FreeChunks(free_);
+    free_ = nullptr;
+}
+
+size_t AhmArena::UsedBytes() const {
+    return used_bytes_;
+}
+
+size_t AhmArena::ReservedBytes() const {
+    return reserved_bytes_;
+}
+
+bool AhmArena::NextChunk() {
+    Chunk* chunk = free_;
+    if (chunk) {
+        free_ = chunk->next;
+    } else {
+        chunk = static_cast<Chunk*>(ahm_.MallocOnHeap(heap_index_, chunk_bytes_));
+        if (!chunk) {
+            return false;
+        }
+        chunk->size = chunk_bytes_;
+        reserved_bytes_ += chunk_bytes_;
+    }
+    chunk->next = used_;
+    used_ = chunk;
+    current_ = chunk;
+    cursor_ = reinterpret_cast<uintptr_t>(chunk + 1);
+    limit_ = reinterpret_cast<uintptr_t>(chunk) + chunk->size;
+    return true;
+}
+
+void* AhmArena::AllocateLarge(size_t size, size_t alignment) {
+    // Blok iz AHM-a je poravnat na kDefaultAlignment; za vece poravnanje
+    // dodaje se visak da bi poravnata adresa stala.
+    size_t padding = alignment > kDefaultAlignment ? alignment : 0;
+    if (size > SIZE_MAX - sizeof(Chunk) - padding) {
+        return nullptr;
+    }
+    size_t bytes = sizeof(Chunk) + padding + size;
+    Chunk* chunk = static_cast<Chunk*>(ahm_.MallocOnHeap(heap_index_, bytes));
+    if (!chunk) {
+        return nullptr;
+    }
+    chunk->size = bytes;
+    chunk->next = large_;
+    large_ = chunk;
+    reserved_bytes_ += bytes;
+    used_bytes_ += size;
+    return reinterpret_cast<void*>(AlignUp(reinterpret_cast<uintptr_t>(chunk + 1), alignment));
+}
+
+void AhmArena::FreeChunks(Chunk* chunk) {
+    while (chunk) {
+        Chunk* next = chunk->next;
+        reserved_bytes_ -= chunk->size;
+        ahm_.FreeHinted(chunk, heap_index_);
+        chunk = next;
+    }
+}
+
+void* AhmArenaResource::do_allocate(size_t bytes, size_t alignment) {
+    void* ptr = arena_.Allocate(bytes, alignment);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void AhmArenaResource::do_deallocate(void* ptr, size_t bytes, size_t alignment) {
+    (void)ptr;
+    (void)bytes;
+    (void)alignment;
+}
+
+bool AhmArenaResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+#include "ahm_fwd.h"
+
+// Arena sa bump alokacijom za memoriju istog zivotnog veka (npr. jedan zahtev).
+// Blokove (chunk-ove) uzima iz jednog heap-a AHM-a, objekti nemaju nikakve
+// metapodatke i ne oslobadjaju se pojedinacno: Reset() vraca celu arenu na
+// pocetak. Obicni chunk-ovi se posle Reset-a ponovo koriste, pa zahtev u
+// ustaljenom stanju uopste ne ide u AHM; Release() ih vraca heap-u.
+// Klasa nije thread-safe; predvidjena je jedna arena po niti/konekciji.
+class AhmArena {
+public:
+    static const size_t kDefaultChunkBytes = 64 * 1024;
+    static const size_t kDefaultAlignment = 2 * sizeof(void*);
+
+    AhmArena(AdvancedHeapManager& ahm, size_t heap_index, size_t chunk_bytes = kDefaultChunkBytes);
+    ~AhmArena();
+
+    AhmArena(const AhmArena&) = delete;
+    AhmArena& operator=(const AhmArena&) = delete;
+
+    // alignment mora biti stepen dvojke, inace vraca nullptr. Zahtevi veci od
+    // cetvrtine chunk-a dobijaju sopstveni blok, koji Reset odmah oslobadja.
+    void* Allocate(size_t size, size_t alignment = kDefaultAlignment);
+
+    // Oslobadja sve objekte odjednom; obicni chunk-ovi ostaju za ponovnu upotrebu.
+    void Reset();
+    // Kao Reset, ali vraca i sve chunk-ove u AHM.
+    void Release();
+
+    // Bajtovi dodeljeni objektima od poslednjeg Reset-a (sa poravnanjem).
+    size_t UsedBytes() const;
+    // Bajtovi koje arena trenutno drzi iz AHM-a.
+    size_t ReservedBytes() const;
+
+private:
+    // Zaglavlje na pocetku svakog bloka uzetog iz AHM-a; 2 reci, pa je
+    // prostor iza njega poravnat kao i sam blok.
+    struct Chunk {
+        Chunk* next;
+        size_t size;
+    };
+
+    // Prelazi na sledeci obican chunk (sacuvan ili nov iz AHM-a).
+    bool NextChunk();
+    void* AllocateLarge(size_t size, size_t alignment);
+    void FreeChunks(Chunk* chunk);
+
+    static uintptr_t AlignUp(uintptr_t value, size_t alignment) {
+        return (value + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    }
+
+    AdvancedHeapManager& ahm_;
+    size_t heap_index_;
+    size_t chunk_bytes_;
+    // Obicni chunk-ovi: used_ su popunjeni (poslednji je current_), free_ cekaju ponovnu upotrebu.
+    Chunk* used_;
+    Chunk* free_;
+    Chunk* current_;
+    // Posebni blokovi za velike zahteve; zive samo do Reset-a.
+    Chunk* large_;
+    uintptr_t cursor_;
+    uintptr_t limit_;
+    size_t used_bytes_;
+    size_t reserved_bytes_;
+};
+
+// std::pmr adapter nad arenom: do_deallocate ne radi nista (memoriju vraca
+// AhmArena::Reset), pa su pmr kontejneri na areni jeftini za razaranje.
+// Neuspela alokacija baca std::bad_alloc, kako pmr ocekuje.
+class AhmArenaResource : public std::pmr::memory_resource {
+public:
+    explicit AhmArenaResource(AhmArena& arena) : arena_(arena) {}
+
+    AhmArena& Arena() const { return arena_; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    AhmArena& arena_;
+};
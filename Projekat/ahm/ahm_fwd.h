@@ -0,0 +1,19 @@
+#pragma once
+
+#include <mutex>
+
+// Deklaracije unapred za zaglavlja kojima treba samo ime menadzera.
+class LeastBytesBalance;
+struct PageMapMetadata;
+struct HashMetadata;
+
+#ifdef _WIN32
+template <typename TLock, typename TBalance, typename TMetadata = HashMetadata>
+class BasicHeapManager;
+#else
+template <typename TLock, typename TBalance, typename TMetadata = PageMapMetadata>
+class BasicHeapManager;
+#endif
+
+// Podrazumevani menadzer: std::mutex po heap-u i balansiranje po zauzetim bajtovima.
+using AdvancedHeapManager = BasicHeapManager<std::mutex, LeastBytesBalance>;
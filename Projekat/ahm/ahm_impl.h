@@ -0,0 +1,1478 @@
+#pragma once
+
+// Definicije clanova BasicHeapManager-a. Ukljucuje ih ahm.cpp za kombinacije
+// politika navedene u ahm.h; za druge kombinacije (ili sopstvene politike)
+// ukljuciti ovaj fajl umesto ahm.h.
+
+#include "ahm.h"
+
+#include "ahm_trace.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+namespace ahm_detail {
+// Monoton casovnik za decay vracanja memorije.
+inline uint64_t SteadyMilliseconds() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Najvise elemenata serije koji se grupisu odjednom (nizovi na steku).
+const size_t kBatchChunk = 64;
+
+// Grupise pokazivace po grupi (heap ili shard) u delovima od kBatchChunk i za
+// svaku grupu u delu jednom poziva process(group, indices, count), da bi se
+// zakljucavanje grupe uzimalo jednom umesto za svaki pokazivac.
+template <typename TGroupOf, typename TProcess>
+inline void ForEachGroup(void** items, size_t count, TGroupOf group_of, TProcess process) {
+    size_t groups[kBatchChunk];
+    size_t indices[kBatchChunk];
+    bool done[kBatchChunk];
+    for (size_t begin = 0; begin < count; begin += kBatchChunk) {
+        size_t length = std::min(count - begin, kBatchChunk);
+        for (size_t i = 0; i < length; ++i) {
+            groups[i] = group_of(items[begin + i]);
+            done[i] = false;
+        }
+        for (size_t first = 0; first < length; ++first) {
+            if (done[first]) {
+                continue;
+            }
+            size_t members = 0;
+            for (size_t i = first; i < length; ++i) {
+                if (!done[i] && groups[i] == groups[first]) {
+                    indices[members++] = begin + i;
+                    done[i] = true;
+                }
+            }
+            process(groups[first], indices, members);
+        }
+    }
+}
+
+// Zakljucava mutex heap-a (ili shard-a) i broji zakljucavanja u njegovim
+// brojacima. Sporno je zakljucavanje koje try_lock nije dobio odmah.
+template <typename THeap>
+class HeapLock {
+public:
+    explicit HeapLock(THeap& heap) : heap_(heap) {
+#ifdef AHM_PROFILE
+        uint64_t start = ProfileClock();
+#endif
+        if (!heap.mutex.try_lock()) {
+            heap.mutex.lock();
+            heap.contended_locks.fetch_add(1, std::memory_order_relaxed);
+        }
+        CountAcquisition();
+#ifdef AHM_PROFILE
+        heap.lock_wait.Record(ProfileClock() - start);
+#endif
+    }
+    // Mutex je vec zakljucan uspesnim try_lock.
+    HeapLock(THeap& heap, std::adopt_lock_t) : heap_(heap) {
+        CountAcquisition();
+    }
+    ~HeapLock() {
+        heap_.mutex.unlock();
+    }
+
+    HeapLock(const HeapLock&) = delete;
+    HeapLock& operator=(const HeapLock&) = delete;
+
+private:
+    // Brojac se menja samo pod mutex-om, pa atomicno sabiranje nije potrebno.
+    void CountAcquisition() {
+        heap_.lock_acquisitions.store(heap_.lock_acquisitions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    THeap& heap_;
+};
+
+// Meri trajanje opsega kao fazu profila u bloku niti; bez AHM_PROFILE je prazna.
+class ProfileScope {
+public:
+#ifdef AHM_PROFILE
+    ProfileScope(StatsControl* control, AhmProfilePhase phase) : control_(control), phase_(phase), start_(ProfileClock()) {}
+    ~ProfileScope() {
+        GetThreadStats(control_)->OnPhase(phase_, ProfileClock() - start_);
+    }
+#else
+    ProfileScope(StatsControl*, AhmProfilePhase) {}
+#endif
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+#ifdef AHM_PROFILE
+private:
+    StatsControl* control_;
+    AhmProfilePhase phase_;
+    uint64_t start_;
+#endif
+};
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+BasicHeapManager<TLock, TBalance, TMetadata>::BasicHeapManager(const Config& config) {
+    if (config.heap_count == 0) {
+        throw std::invalid_argument("heap_count must be greater than zero");
+    }
+    if (config.maximum_size_bytes != 0 && config.initial_size_bytes > config.maximum_size_bytes) {
+        throw std::invalid_argument("initial_size_bytes must not exceed maximum_size_bytes");
+    }
+    if (!LockTraits<TLock>::kThreadSafe && config.purge_decay_ms > 0) {
+        throw std::invalid_argument("purge_decay_ms requires a thread-safe lock policy");
+    }
+
+#ifndef _WIN32
+    if (config.heap_count > 0xFFFF) {
+        throw std::invalid_argument("heap_count must not exceed 65535");
+    }
+    if (config.large_threshold_bytes != 0 && config.large_threshold_bytes <= SizeClasses::kMaxSmallSize) {
+        throw std::invalid_argument("large_threshold_bytes must be 0 or greater than the largest size class");
+    }
+    cache_control_ = nullptr;
+    page_map_ = new PageMap();
+#endif
+    heaps_.Reset(config.heap_count);
+#ifndef _WIN32
+    if (kHashMetadata) {
+        live_shards_.Reset(config.heap_count);
+    }
+#endif
+
+    // Kreiraj konfigurabilan broj heap-ova (HeapCreate / mmap arene).
+    for (size_t i = 0; i < config.heap_count; ++i) {
+#ifdef _WIN32
+        // Bez zakljucavanja menadzera ni Windows heap ne mora da se serijalizuje.
+        DWORD options = LockTraits<TLock>::kThreadSafe ? 0 : HEAP_NO_SERIALIZE;
+        HANDLE heap = HeapCreate(options, config.initial_size_bytes, config.maximum_size_bytes);
+        if (!heap) {
+            DestroyHeaps();
+            throw std::runtime_error("HeapCreate failed");
+        }
+        heaps_[i].handle = heap;
+#else
+        try {
+            heaps_[i].handle = new MmapArena(i, page_map_, config.initial_size_bytes, config.maximum_size_bytes, config.huge_pages,
+                config.large_threshold_bytes, config.large_cache_bytes);
+            heaps_[i].slabs = new SlabHeap(i, heaps_[i].handle, page_map_);
+        } catch (...) {
+            DestroyHeaps();
+            throw;
+        }
+#endif
+    }
+
+#ifndef _WIN32
+    if (config.thread_cache_bytes > 0) {
+        cache_control_ = new ThreadCacheControl();
+        cache_control_->context = this;
+        cache_control_->release = &BasicHeapManager::ReleaseCachedBlocks;
+        cache_control_->capacity_bytes = config.thread_cache_bytes;
+    }
+#endif
+
+    stats_control_ = new StatsControl();
+    profile_report_ = config.profile_report;
+
+    if (config.trace_path) {
+        try {
+            trace_ = new AhmTraceRecorder(config.trace_path, config.trace_capacity_bytes);
+        } catch (...) {
+            RetireStatsControl(stats_control_);
+#ifndef _WIN32
+            if (cache_control_) {
+                RetireThreadCacheControl(cache_control_);
+            }
+#endif
+            DestroyHeaps();
+            throw;
+        }
+    }
+
+    if (config.prefault) {
+        // Pocetna velicina je vec mapirana, pa WarmUp ne moze da ne uspe.
+        WarmUp(config.initial_size_bytes);
+    }
+
+    if (config.purge_decay_ms > 0) {
+        purge_thread_ = std::thread(&BasicHeapManager::PurgeLoop, this, static_cast<uint64_t>(config.purge_decay_ms));
+    }
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+BasicHeapManager<TLock, TBalance, TMetadata>::~BasicHeapManager() {
+    StopPurgeThread();
+#ifdef AHM_PROFILE
+    if (profile_report_) {
+        WriteProfileReport(stderr);
+    }
+#endif
+    delete trace_;
+    RetireStatsControl(stats_control_);
+#ifndef _WIN32
+    if (cache_control_) {
+        RetireThreadCacheControl(cache_control_);
+    }
+#endif
+    DestroyHeaps();
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::DestroyHeaps() {
+    for (size_t i = 0; i < heaps_.Size(); ++i) {
+        if (heaps_[i].handle) {
+#ifdef _WIN32
+            HeapDestroy(heaps_[i].handle);
+#else
+            // Slab-ovi zive u segmentima arene, pa se arena unistava poslednja.
+            delete heaps_[i].slabs;
+            heaps_[i].slabs = nullptr;
+            delete heaps_[i].handle;
+#endif
+            heaps_[i].handle = nullptr;
+        }
+    }
+#ifndef _WIN32
+    delete page_map_;
+    page_map_ = nullptr;
+#endif
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void* BasicHeapManager<TLock, TBalance, TMetadata>::Malloc(size_t size) {
+    ahm_detail::ProfileScope profile(stats_control_, kPhaseMalloc);
+    void* ptr = MallocUntraced(size);
+    CountAllocation(ptr, size);
+    if (trace_ && ptr) {
+        trace_->Record(kTraceMalloc, ptr, size, trace_->Now());
+    }
+    return ptr;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void* BasicHeapManager<TLock, TBalance, TMetadata>::MallocUntraced(size_t size) {
+    if (size == 0) {
+        size = 1;
+    }
+
+#ifdef _WIN32
+    return MallocOnHeapUntraced(SelectHeapIndex(), size);
+#else
+    if (size <= SizeClasses::kMaxSmallSize) {
+        return RecordLive(MallocSmall(SizeClasses::Index(size)));
+    }
+
+    size_t heap_index = SelectHeapIndex();
+    ahm_detail::HeapLock<Heap> lock(heaps_[heap_index]);
+    return RecordLive(MallocLocked(heap_index, size));
+#endif
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void* BasicHeapManager<TLock, TBalance, TMetadata>::MallocOnHeap(size_t heap_index, size_t size) {
+    void* ptr = MallocOnHeapUntraced(heap_index, size);
+    CountAllocation(ptr, size);
+    if (trace_ && ptr) {
+        trace_->Record(kTraceMalloc, ptr, size, trace_->Now());
+    }
+    return ptr;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void* BasicHeapManager<TLock, TBalance, TMetadata>::MallocOnHeapUntraced(size_t heap_index, size_t size) {
+    if (heap_index >= heaps_.Size()) {
+        return nullptr;
+    }
+    if (size == 0) {
+        size = 1;
+    }
+
+#ifdef _WIN32
+    // HeapAlloc je vec serijalizovan po heap-u; zakljucava se samo shard mape.
+    Heap& heap = heaps_[heap_index];
+    void* ptr = nullptr;
+    {
+        ahm_detail::ProfileScope profile(stats_control_, kPhaseHeapCall);
+        ptr = HeapAlloc(heap.handle, 0, size);
+    }
+    if (!ptr) {
+        return nullptr;
+    }
+    AddAllocatedBytes(heap, size);
+    // Sacuvaj vlasnistvo alokacije za pravilan Free.
+    Heap& shard = heaps_[ShardIndex(ptr)];
+    ahm_detail::HeapLock<Heap> lock(shard);
+    ahm_detail::ProfileScope profile(stats_control_, kPhaseMapLookup);
+    shard.allocations.Insert(ptr, AllocationInfo{heap_index, size});
+    return ptr;
+#else
+    // Kes niti se preskace: njegovi slotovi mogu biti iz bilo kog heap-a.
+    ahm_detail::HeapLock<Heap> lock(heaps_[heap_index]);
+    if (size <= SizeClasses::kMaxSmallSize) {
+        return RecordLive(MallocSmallLocked(heap_index, SizeClasses::Index(size)));
+    }
+    return RecordLive(MallocLocked(heap_index, size));
+#endif
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void* BasicHeapManager<TLock, TBalance, TMetadata>::MallocAligned(size_t size, size_t alignment) {
+    void* ptr = MallocAlignedUntraced(size, alignment);
+    CountAllocation(ptr, size);
+    if (trace_ && ptr) {
+        trace_->Record(kTraceMalloc, ptr, size, trace_->Now(), alignment);
+    }
+    return ptr;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void* BasicHeapManager<TLock, TBalance, TMetadata>::MallocAlignedUntraced(size_t size, size_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > kMaxAlignment) {
+        return nullptr;
+    }
+    if (alignment <= kMinAlignment) {
+        return MallocUntraced(size);
+    }
+    if (size == 0) {
+        size = 1;
+    }
+
+#ifdef _WIN32
+    // Visak od alignment bajtova, a u mapi se uz poravnatu adresu cuva i
+    // adresa koju treba vratiti HeapFree-u.
+    if (size > SIZE_MAX - alignment) {
+        return nullptr;
+    }
+    size_t heap_index = SelectHeapIndex();
+    Heap& heap = heaps_[heap_index];
+    void* block = HeapAlloc(heap.handle, 0, size + alignment);
+    if (!block) {
+        return nullptr;
+    }
+    uintptr_t address = (reinterpret_cast<uintptr_t>(block) + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    void* ptr = reinterpret_cast<void*>(address);
+    AddAllocatedBytes(heap, size + alignment);
+    Heap& shard = heaps_[ShardIndex(ptr)];
+    ahm_detail::HeapLock<Heap> lock(shard);
+    shard.allocations.Insert(ptr, AllocationInfo{heap_index, size + alignment, block});
+    return ptr;
+#else
+    if (size <= SizeClasses::kMaxSmallSize && alignment <= SizeClasses::kMaxSmallSize) {
+        // Slab-ovi su poravnati na 64 KiB, a slot klase je na umnosku njene
+        // velicine: dovoljno je uzeti klasu cija je velicina deljiva sa alignment.
+        size_t size_class = SizeClasses::Index(size > alignment ? size : alignment);
+        while (SizeClasses::Size(size_class) % alignment != 0) {
+            ++size_class;
+        }
+        return RecordLive(MallocSmall(size_class));
+    }
+
+    size_t heap_index = SelectHeapIndex();
+    Heap& heap = heaps_[heap_index];
+    ahm_detail::HeapLock<Heap> lock(heap);
+    void* ptr = heap.handle->AllocateAligned(size, alignment);
+    if (!ptr) {
+        return nullptr;
+    }
+    AddAllocatedBytes(heap, MmapArena::UsableSize(ptr));
+    return RecordLive(ptr);
+#endif
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::Free(void* ptr) {
+    ahm_detail::ProfileScope profile(stats_control_, kPhaseFree);
+    // Oslobadjanje se upisuje pre nego sto se izvrsi: posle njega druga nit
+    // moze da dobije istu adresu, a njen zapis mora biti kasniji.
+    if (ptr) {
+        GetThreadStats(stats_control_)->OnFrees(1);
+        if (trace_) {
+            trace_->Record(kTraceFree, ptr, 0, trace_->Now());
+        }
+    }
+    FreeUntraced(ptr);
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::FreeUntraced(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+#ifdef _WIN32
+    // Pronadji heap iz kog je alocirano i vrati memoriju u isti heap.
+    AllocationInfo info{};
+    {
+        Heap& shard = heaps_[ShardIndex(ptr)];
+        ahm_detail::HeapLock<Heap> lock(shard);
+        ahm_detail::ProfileScope profile(stats_control_, kPhaseMapLookup);
+        if (!shard.allocations.Find(ptr, info)) {
+            return;
+        }
+        shard.allocations.Erase(ptr);
+    }
+    Heap& heap = heaps_[info.heap_index];
+    {
+        ahm_detail::ProfileScope profile(stats_control_, kPhaseHeapCall);
+        HeapFree(heap.handle, 0, info.block ? info.block : ptr);
+    }
+    heap.allocated_bytes.fetch_sub(info.size_bytes, std::memory_order_relaxed);
+#else
+    // Vlasnik i klasa se citaju iz mape stranica, bez zakljucavanja i bez
+    // hash probe (uz HashMetadata iz shard-a zivih blokova).
+    uint32_t entry = 0;
+    {
+        ahm_detail::ProfileScope profile(stats_control_, kPhaseMapLookup);
+        entry = TakeEntry(ptr);
+    }
+    if (!entry) {
+        return;
+    }
+    size_t size_class = PageMap::SizeClass(entry);
+    if (size_class == PageMap::kUnusedClass) {
+        return;
+    }
+    size_t heap_index = PageMap::HeapIndex(entry);
+
+    if (size_class != 0 && cache_control_) {
+        ThreadCache* cache = GetThreadCache(cache_control_);
+        if (cache) {
+            FreeCached(cache, ptr, size_class);
+            return;
+        }
+    }
+
+    FreeToHeap(heap_index, ptr, size_class);
+#endif
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::FreeSized(void* ptr, size_t size) {
+    if (!ptr) {
+        return;
+    }
+    if (size == 0) {
+        size = 1;
+    }
+    GetThreadStats(stats_control_)->OnFrees(1);
+    if (trace_) {
+        trace_->Record(kTraceFree, ptr, 0, trace_->Now());
+    }
+
+#ifdef _WIN32
+#ifndef NDEBUG
+    {
+        AllocationInfo info{};
+        Heap& shard = heaps_[ShardIndex(ptr)];
+        ahm_detail::HeapLock<Heap> lock(shard);
+        assert((!shard.allocations.Find(ptr, info) || info.block || info.size_bytes == size) &&
+            "FreeSized: size ne odgovara alokaciji");
+    }
+#endif
+    // Mapa alokacija vodi vlasnistvo i mora da izgubi unos, pa nema precice.
+    FreeUntraced(ptr);
+#else
+    if (kHashMetadata) {
+        // Blok mora da izadje iz mape zivih blokova, pa nema precice.
+        FreeUntraced(ptr);
+        return;
+    }
+    size_t size_class = size <= SizeClasses::kMaxSmallSize ? SizeClasses::Index(size) : 0;
+#ifndef NDEBUG
+    uint32_t entry = page_map_->Get(ptr);
+    assert(entry && PageMap::SizeClass(entry) == size_class && "FreeSized: size ne odgovara alokaciji");
+    assert(PageMap::HeapIndex(entry) == MmapArena::OwnerHeap(ptr));
+#endif
+
+    if (size_class != 0 && cache_control_) {
+        ThreadCache* cache = GetThreadCache(cache_control_);
+        if (cache) {
+            FreeCached(cache, ptr, size_class);
+            return;
+        }
+    }
+
+    size_t heap_index = MmapArena::OwnerHeap(ptr);
+    FreeToHeap(heap_index, ptr, size_class);
+#endif
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::FreeHinted(void* ptr, size_t heap_index) {
+    if (!ptr) {
+        return;
+    }
+    GetThreadStats(stats_control_)->OnFrees(1);
+    if (trace_) {
+        trace_->Record(kTraceFree, ptr, 0, trace_->Now());
+    }
+
+#ifdef _WIN32
+#ifndef NDEBUG
+    {
+        AllocationInfo info{};
+        Heap& shard = heaps_[ShardIndex(ptr)];
+        ahm_detail::HeapLock<Heap> lock(shard);
+        assert((!shard.allocations.Find(ptr, info) || info.heap_index == heap_index) &&
+            "FreeHinted: blok nije iz heap-a heap_index");
+    }
+#endif
+    // Shard mape zavisi od adrese, ne od heap-a, pa nagovestaj nista ne stedi.
+    (void)heap_index;
+    FreeUntraced(ptr);
+#else
+    uint32_t entry = TakeEntry(ptr);
+    size_t size_class = PageMap::SizeClass(entry);
+    if (!entry || size_class == PageMap::kUnusedClass) {
+        return;
+    }
+    assert(PageMap::HeapIndex(entry) == heap_index && "FreeHinted: blok nije iz heap-a heap_index");
+
+    if (size_class != 0 && cache_control_) {
+        ThreadCache* cache = GetThreadCache(cache_control_);
+        if (cache) {
+            FreeCached(cache, ptr, size_class);
+            return;
+        }
+    }
+
+    FreeToHeap(heap_index, ptr, size_class);
+#endif
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void* BasicHeapManager<TLock, TBalance, TMetadata>::Realloc(void* ptr, size_t size) {
+    // Stara adresa dobija vreme pre poziva (vec tada moze biti slobodna za
+    // druge niti), a nova vreme posle njega, kao kod Free i Malloc.
+    uint64_t start = trace_ ? trace_->Now() : 0;
+    void* result = ReallocUntraced(ptr, size);
+    if (!ptr) {
+        CountAllocation(result, size);
+        if (trace_ && result) {
+            trace_->Record(kTraceMalloc, result, size, trace_->Now());
+        }
+    } else if (size == 0) {
+        GetThreadStats(stats_control_)->OnFrees(1);
+        if (trace_) {
+            trace_->Record(kTraceFree, ptr, 0, start);
+        }
+    } else if (result) {
+        GetThreadStats(stats_control_)->OnReallocation(size);
+        if (trace_) {
+            trace_->Record(kTraceReallocFrom, ptr, 0, start);
+            trace_->Record(kTraceRealloc, result, size, trace_->Now());
+        }
+    } else {
+        GetThreadStats(stats_control_)->OnFailedAllocation();
+    }
+    return result;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void* BasicHeapManager<TLock, TBalance, TMetadata>::ReallocUntraced(void* ptr, size_t size) {
+    if (!ptr) {
+        return MallocUntraced(size);
+    }
+    if (size == 0) {
+        FreeUntraced(ptr);
+        return nullptr;
+    }
+
+    size_t old_size = 0;
+#ifdef _WIN32
+    AllocationInfo info{};
+    {
+        Heap& shard = heaps_[ShardIndex(ptr)];
+        ahm_detail::HeapLock<Heap> lock(shard);
+        if (!shard.allocations.Find(ptr, info)) {
+            return nullptr;
+        }
+    }
+    if (!info.block) {
+        // HeapReAlloc ostaje u istom heap-u i sam bira rast u mestu ili premestanje.
+        Heap& heap = heaps_[info.heap_index];
+        void* moved = HeapReAlloc(heap.handle, 0, ptr, size);
+        if (!moved) {
+            return nullptr;
+        }
+        if (size >= info.size_bytes) {
+            AddAllocatedBytes(heap, size - info.size_bytes);
+        } else {
+            heap.allocated_bytes.fetch_sub(info.size_bytes - size, std::memory_order_relaxed);
+        }
+        if (moved != ptr) {
+            Heap& old_shard = heaps_[ShardIndex(ptr)];
+            ahm_detail::HeapLock<Heap> lock(old_shard);
+            old_shard.allocations.Erase(ptr);
+        }
+        Heap& shard = heaps_[ShardIndex(moved)];
+        ahm_detail::HeapLock<Heap> lock(shard);
+        shard.allocations.Insert(moved, AllocationInfo{info.heap_index, size, nullptr});
+        return moved;
+    }
+    // Poravnat blok: upotrebljivo je size_bytes umanjeno za pomeraj od pocetka.
+    old_size = info.size_bytes - static_cast<size_t>(static_cast<char*>(ptr) - static_cast<char*>(info.block));
+#else
+    uint32_t entry = FindEntry(ptr);
+    size_t size_class = PageMap::SizeClass(entry);
+    if (!entry || size_class == PageMap::kUnusedClass) {
+        return nullptr;
+    }
+
+    if (size_class != 0) {
+        // Slot ostaje samo ako nova velicina pada u istu klasu: tada je klasa
+        // i dalje SizeClasses::Index(size), sto FreeSized pretpostavlja.
+        old_size = SizeClasses::Size(size_class);
+        if (size <= SizeClasses::kMaxSmallSize && SizeClasses::Index(size) == size_class) {
+            return ptr;
+        }
+    } else {
+        // Mala velicina uvek prelazi u slab, iz istog razloga.
+        old_size = MmapArena::UsableSize(ptr);
+        if (size > SizeClasses::kMaxSmallSize) {
+            size_t heap_index = PageMap::HeapIndex(entry);
+            Heap& heap = heaps_[heap_index];
+            ahm_detail::HeapLock<Heap> lock(heap);
+            // Stara adresa izlazi iz mape zivih blokova pre nego sto je mremap
+            // oslobodi (druga nit tada moze da dobije istu adresu).
+            if (kHashMetadata) {
+                TakeEntry(ptr);
+            }
+            void* resized = heap.handle->Reallocate(ptr, size);
+            if (resized) {
+                size_t new_size = MmapArena::UsableSize(resized);
+                if (new_size >= old_size) {
+                    AddAllocatedBytes(heap, new_size - old_size);
+                } else {
+                    heap.allocated_bytes.fetch_sub(old_size - new_size, std::memory_order_relaxed);
+                }
+                return RecordLive(resized);
+            }
+            // Premestanje unutar istog heap-a, pod istim zakljucavanjem.
+            void* moved = MallocLocked(heap_index, size);
+            if (!moved) {
+                RecordLive(ptr);
+                return nullptr;
+            }
+            std::memcpy(moved, ptr, size < old_size ? size : old_size);
+            FreeLocked(heap_index, ptr, 0);
+            return RecordLive(moved);
+        }
+    }
+#endif
+
+    // Nije moguce u mestu: nova alokacija, kopija i oslobadjanje starog bloka.
+    void* moved = MallocUntraced(size);
+    if (!moved) {
+        return nullptr;
+    }
+    std::memcpy(moved, ptr, size < old_size ? size : old_size);
+    FreeUntraced(ptr);
+    return moved;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void* BasicHeapManager<TLock, TBalance, TMetadata>::Calloc(size_t count, size_t size) {
+    void* ptr = CallocUntraced(count, size);
+    CountAllocation(ptr, count * size);
+    if (trace_ && ptr) {
+        trace_->Record(kTraceCalloc, ptr, count * size, trace_->Now());
+    }
+    return ptr;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void* BasicHeapManager<TLock, TBalance, TMetadata>::CallocUntraced(size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        return nullptr;
+    }
+    size_t total = count * size;
+    if (total == 0) {
+        total = 1;
+    }
+
+#ifdef _WIN32
+    size_t heap_index = SelectHeapIndex();
+    Heap& heap = heaps_[heap_index];
+    void* ptr = HeapAlloc(heap.handle, HEAP_ZERO_MEMORY, total);
+    if (!ptr) {
+        return nullptr;
+    }
+    AddAllocatedBytes(heap, total);
+    Heap& shard = heaps_[ShardIndex(ptr)];
+    ahm_detail::HeapLock<Heap> lock(shard);
+    shard.allocations.Insert(ptr, AllocationInfo{heap_index, total});
+    return ptr;
+#else
+    if (total <= SizeClasses::kMaxSmallSize) {
+        void* ptr = MallocSmall(SizeClasses::Index(total));
+        if (ptr) {
+            std::memset(ptr, 0, total);
+        }
+        return RecordLive(ptr);
+    }
+
+    size_t heap_index = SelectHeapIndex();
+    Heap& heap = heaps_[heap_index];
+    ahm_detail::HeapLock<Heap> lock(heap);
+    void* ptr = heap.handle->AllocateZeroed(total);
+    if (!ptr) {
+        return nullptr;
+    }
+    AddAllocatedBytes(heap, MmapArena::UsableSize(ptr));
+    return RecordLive(ptr);
+#endif
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+size_t BasicHeapManager<TLock, TBalance, TMetadata>::MallocBatch(size_t size, size_t count, void** out) {
+    if (!out) {
+        return 0;
+    }
+    if (size == 0) {
+        size = 1;
+    }
+
+    size_t allocated = 0;
+#ifdef _WIN32
+    // Cela serija ide iz jednog heap-a, a upis u mapu grupise se po shard-u.
+    size_t heap_index = SelectHeapIndex();
+    Heap& heap = heaps_[heap_index];
+    for (; allocated < count; ++allocated) {
+        void* ptr = HeapAlloc(heap.handle, 0, size);
+        if (!ptr) {
+            break;
+        }
+        out[allocated] = ptr;
+    }
+    AddAllocatedBytes(heap, size * allocated);
+    ahm_detail::ForEachGroup(out, allocated, [this](void* ptr) { return ShardIndex(ptr); },
+        [&](size_t shard_index, const size_t* indices, size_t members) {
+            Heap& shard = heaps_[shard_index];
+            ahm_detail::HeapLock<Heap> lock(shard);
+            for (size_t i = 0; i < members; ++i) {
+                shard.allocations.Insert(out[indices[i]], AllocationInfo{heap_index, size});
+            }
+        });
+#else
+    if (size <= SizeClasses::kMaxSmallSize) {
+        // Prvo sto ima u kesu niti, ostatak iz slab-ova jednog heap-a pod
+        // jednim zakljucavanjem.
+        size_t size_class = SizeClasses::Index(size);
+        ThreadCache* cache = cache_control_ ? GetThreadCache(cache_control_) : nullptr;
+        while (cache && allocated < count) {
+            void* ptr = cache->Pop(size_class);
+            if (!ptr) {
+                break;
+            }
+            out[allocated++] = ptr;
+        }
+        if (allocated < count) {
+            size_t heap_index = SelectHeapIndex();
+            ahm_detail::HeapLock<Heap> lock(heaps_[heap_index]);
+            for (; allocated < count; ++allocated) {
+                void* ptr = MallocSmallLocked(heap_index, size_class);
+                if (!ptr) {
+                    break;
+                }
+                out[allocated] = ptr;
+            }
+        }
+    } else {
+        size_t heap_index = SelectHeapIndex();
+        ahm_detail::HeapLock<Heap> lock(heaps_[heap_index]);
+        for (; allocated < count; ++allocated) {
+            void* ptr = MallocLocked(heap_index, size);
+            if (!ptr) {
+                break;
+            }
+            out[allocated] = ptr;
+        }
+    }
+    RecordLiveBatch(out, allocated);
+#endif
+
+    ThreadStatsBlock* stats = GetThreadStats(stats_control_);
+    stats->OnAllocations(size, allocated);
+    if (allocated < count) {
+        stats->OnFailedAllocation();
+    }
+    if (trace_) {
+        uint64_t now = trace_->Now();
+        for (size_t i = 0; i < allocated; ++i) {
+            trace_->Record(kTraceMalloc, out[i], size, now);
+        }
+    }
+    for (size_t i = allocated; i < count; ++i) {
+        out[i] = nullptr;
+    }
+    return allocated;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::FreeBatch(void** ptrs, size_t count) {
+    if (!ptrs) {
+        return;
+    }
+    size_t freed = 0;
+    uint64_t now = trace_ ? trace_->Now() : 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (ptrs[i]) {
+            ++freed;
+            if (trace_) {
+                trace_->Record(kTraceFree, ptrs[i], 0, now);
+            }
+        }
+    }
+    GetThreadStats(stats_control_)->OnFrees(freed);
+
+#ifdef _WIN32
+    for (size_t begin = 0; begin < count; begin += ahm_detail::kBatchChunk) {
+        size_t length = std::min(count - begin, ahm_detail::kBatchChunk);
+        void** chunk = ptrs + begin;
+        AllocationInfo infos[ahm_detail::kBatchChunk];
+        bool found[ahm_detail::kBatchChunk] = {};
+        // Izbacivanje iz mape pod jednim zakljucavanjem po shard-u.
+        ahm_detail::ForEachGroup(chunk, length, [this](void* ptr) { return ShardIndex(ptr); },
+            [&](size_t shard_index, const size_t* indices, size_t members) {
+                Heap& shard = heaps_[shard_index];
+                ahm_detail::HeapLock<Heap> lock(shard);
+                for (size_t i = 0; i < members; ++i) {
+                    size_t index = indices[i];
+                    if (chunk[index] && shard.allocations.Find(chunk[index], infos[index])) {
+                        shard.allocations.Erase(chunk[index]);
+                        found[index] = true;
+                    }
+                }
+            });
+        for (size_t i = 0; i < length; ++i) {
+            if (found[i]) {
+                Heap& heap = heaps_[infos[i].heap_index];
+                HeapFree(heap.handle, 0, infos[i].block ? infos[i].block : chunk[i]);
+                heap.allocated_bytes.fetch_sub(infos[i].size_bytes, std::memory_order_relaxed);
+            }
+        }
+    }
+#else
+    ThreadCache* cache = cache_control_ ? GetThreadCache(cache_control_) : nullptr;
+    void* blocks[ahm_detail::kBatchChunk];
+    uint32_t entries[ahm_detail::kBatchChunk];
+    size_t pending = 0;
+    for (size_t begin = 0; begin < count; begin += ahm_detail::kBatchChunk) {
+        size_t length = std::min(count - begin, ahm_detail::kBatchChunk);
+        void** chunk = ptrs + begin;
+        TakeEntries(chunk, length, entries);
+        for (size_t i = 0; i < length; ++i) {
+            uint32_t entry = entries[i];
+            if (!entry || PageMap::SizeClass(entry) == PageMap::kUnusedClass) {
+                continue;
+            }
+            size_t size_class = PageMap::SizeClass(entry);
+            if (size_class != 0 && cache) {
+                FreeCached(cache, chunk[i], size_class);
+                continue;
+            }
+            blocks[pending++] = chunk[i];
+            if (pending == ahm_detail::kBatchChunk) {
+                ReleaseBlocks(blocks, pending);
+                pending = 0;
+            }
+        }
+    }
+    ReleaseBlocks(blocks, pending);
+#endif
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+size_t BasicHeapManager<TLock, TBalance, TMetadata>::UsableSize(void* ptr) {
+    if (!ptr) {
+        return 0;
+    }
+
+#ifdef _WIN32
+    AllocationInfo info{};
+    Heap& shard = heaps_[ShardIndex(ptr)];
+    ahm_detail::HeapLock<Heap> lock(shard);
+    if (!shard.allocations.Find(ptr, info)) {
+        return 0;
+    }
+    if (info.block) {
+        return info.size_bytes - static_cast<size_t>(static_cast<char*>(ptr) - static_cast<char*>(info.block));
+    }
+    return info.size_bytes;
+#else
+    uint32_t entry = FindEntry(ptr);
+    size_t size_class = PageMap::SizeClass(entry);
+    if (!entry || size_class == PageMap::kUnusedClass) {
+        return 0;
+    }
+    return size_class != 0 ? SizeClasses::Size(size_class) : MmapArena::UsableSize(ptr);
+#endif
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+size_t BasicHeapManager<TLock, TBalance, TMetadata>::Purge() {
+    // decay 0: vraca se sve sto je sada slobodno, bez obzira na starost.
+    return PurgeHeaps(ahm_detail::SteadyMilliseconds(), 0);
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+bool BasicHeapManager<TLock, TBalance, TMetadata>::Reserve(size_t bytes_per_heap) {
+    bool reserved = true;
+    for (size_t i = 0; i < heaps_.Size(); ++i) {
+        reserved = WarmUpHeap(i, bytes_per_heap, false) && reserved;
+    }
+    return reserved;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+bool BasicHeapManager<TLock, TBalance, TMetadata>::WarmUp(size_t bytes_per_heap) {
+    // Page fault-ovi razlicitih heap-ova se ne cekaju medjusobno; pozivalac
+    // radi kao jedna od niti.
+    const size_t count = heaps_.Size();
+    size_t thread_count = std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency()));
+    std::atomic<size_t> next{0};
+    std::atomic<bool> warmed{true};
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            if (!WarmUpHeap(i, bytes_per_heap, true)) {
+                warmed.store(false, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    SimpleArray<std::thread> workers;
+    workers.Reset(thread_count - 1);
+    for (size_t t = 0; t < workers.Size(); ++t) {
+        try {
+            workers[t] = std::thread(worker);
+        } catch (const std::system_error&) {
+            // Bez novih niti ostatak heap-ova obradjuju postojece.
+            break;
+        }
+    }
+    worker();
+    for (size_t t = 0; t < workers.Size(); ++t) {
+        if (workers[t].joinable()) {
+            workers[t].join();
+        }
+    }
+    return warmed.load(std::memory_order_relaxed);
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+bool BasicHeapManager<TLock, TBalance, TMetadata>::WarmUpHeap(size_t heap_index, size_t bytes, bool populate) {
+    Heap& heap = heaps_[heap_index];
+#ifdef _WIN32
+    // Heap se povecava blokovima ispod praga za koji HeapAlloc koristi
+    // VirtualAlloc (oni bi se pri HeapFree odmah vratili OS-u), koji se uz
+    // populate dodiruju; svaki blok u prvoj reci cuva prethodni.
+    const size_t kChunkBytes = 256 * 1024;
+    void* chunks = nullptr;
+    bool reserved = true;
+    for (size_t total = 0; total < bytes; total += kChunkBytes) {
+        void* chunk = HeapAlloc(heap.handle, 0, kChunkBytes);
+        if (!chunk) {
+            reserved = false;
+            break;
+        }
+        if (populate) {
+            volatile char* pages = static_cast<volatile char*>(chunk);
+            for (size_t offset = 0; offset < kChunkBytes; offset += 4096) {
+                pages[offset] = 0;
+            }
+        }
+        *static_cast<void**>(chunk) = chunks;
+        chunks = chunk;
+    }
+    while (chunks) {
+        void* next = *static_cast<void**>(chunks);
+        HeapFree(heap.handle, 0, chunks);
+        chunks = next;
+    }
+    return reserved;
+#else
+    ahm_detail::HeapLock<Heap> lock(heap);
+    bool reserved = heap.handle->Reserve(bytes);
+    if (populate) {
+        heap.handle->Populate();
+        heap.slabs->WarmUp(bytes);
+    }
+    return reserved;
+#endif
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+size_t BasicHeapManager<TLock, TBalance, TMetadata>::PurgeHeaps(uint64_t now_ms, uint64_t decay_ms) {
+    size_t released = 0;
+    for (size_t i = 0; i < heaps_.Size(); ++i) {
+        Heap& heap = heaps_[i];
+#ifdef _WIN32
+        // HeapCompact spaja slobodne blokove i decommit-uje velike; starost
+        // blokova Windows ne prati, pa decay odredjuje samo ucestalost.
+        (void)now_ms;
+        (void)decay_ms;
+        HeapCompact(heap.handle, 0);
+#else
+        ahm_detail::HeapLock<Heap> lock(heap);
+        if (heap.remote_frees.load(std::memory_order_relaxed)) {
+            DrainRemoteFrees(i);
+        }
+        released += heap.slabs->Purge(now_ms, decay_ms);
+        released += heap.handle->Purge(now_ms, decay_ms);
+#endif
+    }
+    return released;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::PurgeLoop(uint64_t decay_ms) {
+    // Budjenje cetiri puta po periodu: memorija ostaje neaktivna najvise 1.25 * decay_ms.
+    std::chrono::milliseconds interval(decay_ms / 4 > 0 ? decay_ms / 4 : 1);
+    std::unique_lock<std::mutex> lock(purge_mutex_);
+    while (!purge_stop_) {
+        purge_wakeup_.wait_for(lock, interval);
+        if (purge_stop_) {
+            break;
+        }
+        lock.unlock();
+        PurgeHeaps(ahm_detail::SteadyMilliseconds(), decay_ms);
+        lock.lock();
+    }
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::StopPurgeThread() {
+    if (!purge_thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(purge_mutex_);
+        purge_stop_ = true;
+    }
+    purge_wakeup_.notify_one();
+    purge_thread_.join();
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+size_t BasicHeapManager<TLock, TBalance, TMetadata>::HeapCount() const {
+    return heaps_.Size();
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+size_t BasicHeapManager<TLock, TBalance, TMetadata>::AllocatedBytes(size_t heap_index) const {
+    if (heap_index >= heaps_.Size()) {
+        return 0;
+    }
+    return heaps_[heap_index].allocated_bytes.load(std::memory_order_relaxed);
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+AhmStats BasicHeapManager<TLock, TBalance, TMetadata>::GetStats() const {
+    AhmStats stats;
+    stats.heaps.reserve(heaps_.Size());
+    for (size_t i = 0; i < heaps_.Size(); ++i) {
+        const Heap& heap = heaps_[i];
+        AhmHeapStats heap_stats;
+        heap_stats.live_bytes = heap.allocated_bytes.load(std::memory_order_relaxed);
+        heap_stats.peak_bytes = heap.peak_bytes.load(std::memory_order_relaxed);
+        heap_stats.lock_acquisitions = heap.lock_acquisitions.load(std::memory_order_relaxed);
+        heap_stats.contended_locks = heap.contended_locks.load(std::memory_order_relaxed);
+        stats.live_bytes += heap_stats.live_bytes;
+        stats.peak_bytes += heap_stats.peak_bytes;
+        stats.lock_acquisitions += heap_stats.lock_acquisitions;
+        stats.contended_locks += heap_stats.contended_locks;
+        stats.heaps.push_back(heap_stats);
+    }
+    CollectThreadStats(stats_control_, stats);
+    return stats;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+AhmProfile BasicHeapManager<TLock, TBalance, TMetadata>::GetProfile() const {
+    AhmProfile profile;
+#ifdef AHM_PROFILE
+    profile.enabled = true;
+    profile.tick_unit = ahm_detail::kProfileTickUnit;
+    profile.heaps.resize(heaps_.Size());
+    for (size_t i = 0; i < heaps_.Size(); ++i) {
+        heaps_[i].lock_wait.AddTo(profile.heaps[i]);
+    }
+    CollectThreadPhases(stats_control_, profile.phases);
+#endif
+    return profile;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::WriteProfileReport(std::FILE* out) const {
+    WriteAhmProfileReport(GetProfile(), out);
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::AddAllocatedBytes(Heap& heap, size_t bytes) {
+    size_t now = heap.allocated_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t peak = heap.peak_bytes.load(std::memory_order_relaxed);
+#ifdef _WIN32
+    // HeapAlloc putanje ne drze mutex heap-a, pa vrh moze da podize vise niti.
+    while (now > peak && !heap.peak_bytes.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+    }
+#else
+    // Zauzece raste samo pod mutex-om heap-a, pa je dovoljan obican upis.
+    if (now > peak) {
+        heap.peak_bytes.store(now, std::memory_order_relaxed);
+    }
+#endif
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::CountAllocation(const void* ptr, size_t size) {
+    ThreadStatsBlock* stats = GetThreadStats(stats_control_);
+    if (ptr) {
+        stats->OnAllocations(size, 1);
+    } else {
+        stats->OnFailedAllocation();
+    }
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+size_t BasicHeapManager<TLock, TBalance, TMetadata>::SelectHeapIndex() {
+    size_t count = heaps_.Size();
+    if (count == 1) {
+        return 0;
+    }
+    ahm_detail::ProfileScope profile(stats_control_, kPhaseSelectHeap);
+    return balance_.Select(count, [this](size_t index) {
+        return heaps_[index].allocated_bytes.load(std::memory_order_relaxed);
+    });
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+size_t BasicHeapManager<TLock, TBalance, TMetadata>::ShardIndex(void* ptr) const {
+    size_t value = static_cast<size_t>(reinterpret_cast<uintptr_t>(ptr));
+    value ^= (value >> 33);
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= (value >> 33);
+    return value % heaps_.Size();
+}
+
+#ifndef _WIN32
+template <typename TLock, typename TBalance, typename TMetadata>
+void* BasicHeapManager<TLock, TBalance, TMetadata>::RecordLive(void* ptr) {
+    if (kHashMetadata && ptr) {
+        LiveShard& shard = live_shards_[ShardIndex(ptr)];
+        uint32_t entry = page_map_->Get(ptr);
+        std::lock_guard<TLock> lock(shard.mutex);
+        shard.blocks.Insert(ptr, entry);
+    }
+    return ptr;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::RecordLiveBatch(void** ptrs, size_t count) {
+    if (!kHashMetadata) {
+        return;
+    }
+    ahm_detail::ForEachGroup(ptrs, count, [this](void* ptr) { return ShardIndex(ptr); },
+        [&](size_t shard_index, const size_t* indices, size_t members) {
+            LiveShard& shard = live_shards_[shard_index];
+            std::lock_guard<TLock> lock(shard.mutex);
+            for (size_t i = 0; i < members; ++i) {
+                shard.blocks.Insert(ptrs[indices[i]], page_map_->Get(ptrs[indices[i]]));
+            }
+        });
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+uint32_t BasicHeapManager<TLock, TBalance, TMetadata>::TakeEntry(void* ptr) {
+    if (!kHashMetadata) {
+        return page_map_->Get(ptr);
+    }
+    uint32_t entry = 0;
+    LiveShard& shard = live_shards_[ShardIndex(ptr)];
+    std::lock_guard<TLock> lock(shard.mutex);
+    if (shard.blocks.Find(ptr, entry)) {
+        shard.blocks.Erase(ptr);
+    }
+    return entry;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::TakeEntries(void** ptrs, size_t count, uint32_t* entries) {
+    if (!kHashMetadata) {
+        for (size_t i = 0; i < count; ++i) {
+            entries[i] = ptrs[i] ? page_map_->Get(ptrs[i]) : 0;
+        }
+        return;
+    }
+    ahm_detail::ForEachGroup(ptrs, count, [this](void* ptr) { return ShardIndex(ptr); },
+        [&](size_t shard_index, const size_t* indices, size_t members) {
+            LiveShard& shard = live_shards_[shard_index];
+            std::lock_guard<TLock> lock(shard.mutex);
+            for (size_t i = 0; i < members; ++i) {
+                size_t index = indices[i];
+                entries[index] = 0;
+                if (ptrs[index] && shard.blocks.Find(ptrs[index], entries[index])) {
+                    shard.blocks.Erase(ptrs[index]);
+                }
+            }
+        });
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+uint32_t BasicHeapManager<TLock, TBalance, TMetadata>::FindEntry(void* ptr) {
+    if (!kHashMetadata) {
+        return page_map_->Get(ptr);
+    }
+    uint32_t entry = 0;
+    LiveShard& shard = live_shards_[ShardIndex(ptr)];
+    std::lock_guard<TLock> lock(shard.mutex);
+    shard.blocks.Find(ptr, entry);
+    return entry;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void* BasicHeapManager<TLock, TBalance, TMetadata>::MallocSmall(size_t size_class) {
+    // Mali objekti: kes niti, a tek onda slab izabranog heap-a.
+    if (cache_control_) {
+        ThreadCache* cache = GetThreadCache(cache_control_);
+        if (cache) {
+            return MallocCached(cache, size_class);
+        }
+    }
+    size_t heap_index = SelectHeapIndex();
+    ahm_detail::HeapLock<Heap> lock(heaps_[heap_index]);
+    return MallocSmallLocked(heap_index, size_class);
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void* BasicHeapManager<TLock, TBalance, TMetadata>::MallocLocked(size_t heap_index, size_t size) {
+    Heap& heap = heaps_[heap_index];
+    if (heap.remote_frees.load(std::memory_order_relaxed)) {
+        DrainRemoteFrees(heap_index);
+    }
+    void* ptr = nullptr;
+    {
+        ahm_detail::ProfileScope profile(stats_control_, kPhaseHeapCall);
+        ptr = heap.handle->Allocate(size);
+    }
+    if (!ptr) {
+        return nullptr;
+    }
+    // Zauzece se vodi po upotrebljivoj velicini, koju Free cita iz zaglavlja.
+    AddAllocatedBytes(heap, MmapArena::UsableSize(ptr));
+    return ptr;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void* BasicHeapManager<TLock, TBalance, TMetadata>::MallocSmallLocked(size_t heap_index, size_t size_class) {
+    Heap& heap = heaps_[heap_index];
+    if (heap.remote_frees.load(std::memory_order_relaxed)) {
+        DrainRemoteFrees(heap_index);
+    }
+    void* ptr = nullptr;
+    {
+        ahm_detail::ProfileScope profile(stats_control_, kPhaseHeapCall);
+        ptr = heap.slabs->Allocate(size_class);
+    }
+    if (!ptr) {
+        return nullptr;
+    }
+    AddAllocatedBytes(heap, SizeClasses::Size(size_class));
+    return ptr;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::FreeLocked(size_t heap_index, void* ptr, size_t size_class) {
+    // Zauzece se vodi po upotrebljivoj velicini: klasa ili zaglavlje bloka.
+    size_t bytes = size_class != 0 ? SizeClasses::Size(size_class) : MmapArena::UsableSize(ptr);
+    heaps_[heap_index].allocated_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    ReleaseLocked(heap_index, ptr, size_class);
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::ReleaseLocked(size_t heap_index, void* ptr, size_t size_class) {
+    Heap& heap = heaps_[heap_index];
+    ahm_detail::ProfileScope profile(stats_control_, kPhaseHeapCall);
+    if (size_class != 0) {
+        heap.slabs->Free(ptr, size_class);
+    } else {
+        heap.handle->Free(ptr);
+    }
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::FreeToHeap(size_t heap_index, void* ptr, size_t size_class) {
+    Heap& heap = heaps_[heap_index];
+    if (heap.mutex.try_lock()) {
+        ahm_detail::HeapLock<Heap> lock(heap, std::adopt_lock);
+        if (heap.remote_frees.load(std::memory_order_relaxed)) {
+            DrainRemoteFrees(heap_index);
+        }
+        FreeLocked(heap_index, ptr, size_class);
+        return;
+    }
+    heap.contended_locks.fetch_add(1, std::memory_order_relaxed);
+    // Slab objekat je logicki slobodan odmah. Zaglavlje bloka iz arene se bez
+    // zakljucavanja ne cita (susedi menjaju njegove zastavice), pa se takav blok
+    // oduzima od zauzeca tek pri praznjenju liste.
+    if (size_class != 0) {
+        heap.allocated_bytes.fetch_sub(SizeClasses::Size(size_class), std::memory_order_relaxed);
+    }
+    PushRemoteFrees(heap, ptr, ptr);
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::PushRemoteFrees(Heap& heap, void* first, void* last) {
+    void* head = heap.remote_frees.load(std::memory_order_relaxed);
+    do {
+        *static_cast<void**>(last) = head;
+    } while (!heap.remote_frees.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_relaxed));
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::DrainRemoteFrees(size_t heap_index) {
+    // Cela lista se preuzima odjednom, pa nema ABA problema.
+    void* ptr = heaps_[heap_index].remote_frees.exchange(nullptr, std::memory_order_acquire);
+    while (ptr) {
+        void* next = *static_cast<void**>(ptr);
+        size_t size_class = PageMap::SizeClass(page_map_->Get(ptr));
+        if (size_class != 0) {
+            ReleaseLocked(heap_index, ptr, size_class);
+        } else {
+            FreeLocked(heap_index, ptr, 0);
+        }
+        ptr = next;
+    }
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void* BasicHeapManager<TLock, TBalance, TMetadata>::MallocCached(ThreadCache* cache, size_t size_class) {
+    void* ptr = nullptr;
+    {
+        ahm_detail::ProfileScope profile(stats_control_, kPhaseThreadCache);
+        ptr = cache->Pop(size_class);
+    }
+    if (ptr) {
+        return ptr;
+    }
+
+    // Lista je prazna: uzmi seriju slotova iz slab-ova jednog heap-a.
+    size_t refill = cache->RefillCount(size_class);
+    size_t heap_index = SelectHeapIndex();
+    ahm_detail::HeapLock<Heap> lock(heaps_[heap_index]);
+    ptr = MallocSmallLocked(heap_index, size_class);
+    for (size_t i = 1; ptr && i < refill; ++i) {
+        void* extra = MallocSmallLocked(heap_index, size_class);
+        if (!extra) {
+            break;
+        }
+        cache->Push(size_class, extra);
+    }
+    return ptr;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::FreeCached(ThreadCache* cache, void* ptr, size_t size_class) {
+    bool overflow = false;
+    {
+        ahm_detail::ProfileScope profile(stats_control_, kPhaseThreadCache);
+        overflow = cache->Push(size_class, ptr);
+    }
+    if (!overflow) {
+        return;
+    }
+
+    // Lista je prepunjena: vrati polovinu u heap-ove odjednom.
+    const size_t kMaxFlush = 64;
+    void* blocks[kMaxFlush];
+    size_t flush = (cache->Count(size_class) + 1) / 2;
+    size_t count = cache->Drain(size_class, blocks, flush < kMaxFlush ? flush : kMaxFlush);
+    ReleaseCachedBlocks(this, blocks, count);
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::ReleaseBlocks(void** blocks, size_t count) {
+    // Blokovi istog heap-a oslobadjaju se pod jednim zakljucavanjem.
+    ahm_detail::ForEachGroup(blocks, count, [this](void* ptr) { return PageMap::HeapIndex(page_map_->Get(ptr)); },
+        [&](size_t heap_index, const size_t* indices, size_t members) {
+            Heap& heap = heaps_[heap_index];
+            if (heap.mutex.try_lock()) {
+                ahm_detail::HeapLock<Heap> lock(heap, std::adopt_lock);
+                if (heap.remote_frees.load(std::memory_order_relaxed)) {
+                    DrainRemoteFrees(heap_index);
+                }
+                for (size_t i = 0; i < members; ++i) {
+                    void* ptr = blocks[indices[i]];
+                    FreeLocked(heap_index, ptr, PageMap::SizeClass(page_map_->Get(ptr)));
+                }
+                return;
+            }
+            // Heap je zauzet: grupa se povezuje u lanac i odlaze jednim CAS-om.
+            heap.contended_locks.fetch_add(1, std::memory_order_relaxed);
+            size_t bytes = 0;
+            for (size_t i = 0; i < members; ++i) {
+                void* ptr = blocks[indices[i]];
+                size_t size_class = PageMap::SizeClass(page_map_->Get(ptr));
+                if (size_class != 0) {
+                    bytes += SizeClasses::Size(size_class);
+                }
+                *static_cast<void**>(ptr) = i + 1 < members ? blocks[indices[i + 1]] : nullptr;
+            }
+            heap.allocated_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+            PushRemoteFrees(heap, blocks[indices[0]], blocks[indices[members - 1]]);
+        });
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::ReleaseCachedBlocks(void* context, void** blocks, size_t count) {
+    static_cast<BasicHeapManager*>(context)->ReleaseBlocks(blocks, count);
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::LockForFork() {
+    // Redosled prati ugnjezdavanje: kes niti vraca blokove pod svojim
+    // mutex-om u heap-ove, a brojaci, mapa stranica i predlozi adresa se
+    // zakljucavaju poslednji (pod njima se ne uzima nista drugo).
+    if (cache_control_) {
+        cache_control_->mutex.lock();
+    }
+    for (size_t i = 0; i < heaps_.Size(); ++i) {
+        heaps_[i].mutex.lock();
+    }
+    for (size_t i = 0; i < live_shards_.Size(); ++i) {
+        live_shards_[i].mutex.lock();
+    }
+    if (stats_control_) {
+        stats_control_->mutex.lock();
+    }
+    page_map_->LockForFork();
+    MmapArena::LockForFork();
+}
+
+template <typename TLock, typename TBalance, typename TMetadata>
+void BasicHeapManager<TLock, TBalance, TMetadata>::UnlockAfterFork() {
+    MmapArena::UnlockAfterFork();
+    page_map_->UnlockAfterFork();
+    if (stats_control_) {
+        stats_control_->mutex.unlock();
+    }
+    for (size_t i = live_shards_.Size(); i > 0; --i) {
+        live_shards_[i - 1].mutex.unlock();
+    }
+    for (size_t i = heaps_.Size(); i > 0; --i) {
+        heaps_[i - 1].mutex.unlock();
+    }
+    if (cache_control_) {
+        cache_control_->mutex.unlock();
+    }
+}
+#endif
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Politike za BasicHeapManager (ahm.h).
+//
+// Zakljucavanje heap-a (TLock) je tip sa lock/unlock/try_lock, kao std::mutex,
+// koji je i podrazumevan. Balansiranje (TBalance) bira heap za alokaciju koja
+// ne ide iz kesa niti. Metapodaci (TMetadata) odredjuju kako Free nalazi heap
+// vlasnika (vidi PageMapMetadata i HashMetadata).
+
+namespace ahm_detail {
+// Stanje xorshift generatora po niti; 0 znaci da jos nije inicijalizovano.
+inline thread_local uint64_t tls_random_state = 0;
+
+inline uint64_t NextRandom() {
+    uint64_t x = tls_random_state;
+    if (x == 0) {
+        // Seme iz adrese TLS promenljive je razlicito za svaku nit.
+        x = (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&tls_random_state)) | 1) * 0x9E3779B97F4A7C15ULL;
+    }
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    tls_random_state = x;
+    return x;
+}
+
+// Indeks u [0, count) iz 32 bita, mnozenjem umesto modula.
+inline size_t ScaleToCount(uint64_t value32, size_t count) {
+    return static_cast<size_t>(((value32 & 0xFFFFFFFFu) * count) >> 32);
+}
+
+inline void CpuRelax() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+}
+
+// Spinlock za kratke kriticne sekcije (test-and-test-and-set). Posle kratkog
+// okretanja ustupa procesor, da nit koja drzi zakljucavanje ne ceka na nju
+// kada je niti vise nego jezgara.
+class SpinLock {
+public:
+    void lock() {
+        for (;;) {
+            if (!locked_.exchange(true, std::memory_order_acquire)) {
+                return;
+            }
+            for (unsigned spins = 0; locked_.load(std::memory_order_relaxed); ++spins) {
+                if (spins < kSpinsBeforeYield) {
+                    ahm_detail::CpuRelax();
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+
+    bool try_lock() {
+        return !locked_.load(std::memory_order_relaxed) && !locked_.exchange(true, std::memory_order_acquire);
+    }
+
+    void unlock() {
+        locked_.store(false, std::memory_order_release);
+    }
+
+private:
+    static const unsigned kSpinsBeforeYield = 64;
+
+    std::atomic<bool> locked_{false};
+};
+
+// Bez zakljucavanja: menadzer tada sme da koristi samo jedna nit (npr.
+// jednonitni batch poslovi), a pozadinska nit za purge nije dozvoljena.
+class NullLock {
+public:
+    void lock() {}
+    bool try_lock() { return true; }
+    void unlock() {}
+};
+
+template <typename TLock>
+struct LockTraits {
+    static constexpr bool kThreadSafe = true;
+};
+
+template <>
+struct LockTraits<NullLock> {
+    static constexpr bool kThreadSafe = false;
+};
+
+// Balansiranje: Select(heap_count, load) vraca indeks heap-a, a load(i) daje
+// zauzete bajtove heap-a i (citanje bez zakljucavanja). Poziva se samo kada je
+// heap_count > 1.
+
+// Manje zauzet od dva nasumicna heap-a (power-of-two-choices): blizu
+// najmanje zauzetog, a bez zakljucavanja i uz cenu nezavisnu od broja heap-ova.
+class LeastBytesBalance {
+public:
+    template <typename TLoad>
+    size_t Select(size_t heap_count, TLoad load) {
+        // Dva razlicita indeksa iz jednog 64-bitnog broja.
+        uint64_t random = ahm_detail::NextRandom();
+        size_t first = ahm_detail::ScaleToCount(random, heap_count);
+        size_t second = ahm_detail::ScaleToCount(random >> 32, heap_count - 1);
+        if (second >= first) {
+            ++second;
+        }
+        return load(first) <= load(second) ? first : second;
+    }
+};
+
+// Heap-ovi redom, jedan zajednicki brojac za sve niti.
+class RoundRobinBalance {
+public:
+    template <typename TLoad>
+    size_t Select(size_t heap_count, TLoad) {
+        return next_.fetch_add(1, std::memory_order_relaxed) % heap_count;
+    }
+
+private:
+    std::atomic<size_t> next_{0};
+};
+
+// Svaka nit uvek koristi isti heap (hash niti): nema deljenog stanja, a
+// blokovi jedne niti ostaju zajedno; zauzece heap-ova se ne gleda.
+class ThreadHashBalance {
+public:
+    template <typename TLoad>
+    size_t Select(size_t heap_count, TLoad) {
+        static thread_local uint64_t tls_thread_hash = 0;
+        if (tls_thread_hash == 0) {
+            tls_thread_hash = ((static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&tls_thread_hash)) >> 6) | 1) * 0x9E3779B97F4A7C15ULL;
+        }
+        return ahm_detail::ScaleToCount(tls_thread_hash >> 32, heap_count);
+    }
+};
+
+// Metapodaci alokacija. Uz PageMapMetadata (samo Linux) vlasnika i klasu
+// daje mapa stranica koju pune slab-ovi i arene, bez zakljucavanja; Free
+// tada prihvata i adresu unutar bloka, a dvostruko oslobadjanje ne otkriva.
+// Uz HashMetadata se zivi blokovi vode u hash mapi (AllocationMap)
+// podeljenoj po heap-ovima: na Windows-u jedino tako, jer HeapAlloc vraca
+// proizvoljne adrese, a na Linux-u uz mapu stranica, pa Free, Realloc i
+// UsableSize zanemaruju adrese koje nisu pocetak zivog bloka (i ponovljeni
+// Free) po cenu jednog zakljucavanja i hash probe po operaciji. Mapa
+// alocira operatorom new, pa takav menadzer ne moze biti malloc procesa.
+struct PageMapMetadata {};
+struct HashMetadata {};
+
+#ifdef _WIN32
+using PlatformMetadata = HashMetadata;
+#else
+using PlatformMetadata = PageMapMetadata;
+#endif
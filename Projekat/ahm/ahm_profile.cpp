@@ -0,0 +1,88 @@
+#include "ahm_profile.h"
+
+namespace {
+const char* const kPhaseNames[kProfilePhaseCount] = {
+    "malloc (total)",
+    "free (total)",
+    "select heap",
+    "thread cache",
+    "map lookup",
+    "heap call",
+};
+
+double Average(uint64_t ticks, uint64_t count) {
+    return count != 0 ? static_cast<double>(ticks) / static_cast<double>(count) : 0.0;
+}
+
+// Gornja granica korpe u kojoj je percentil (fraction od 0 do 1).
+uint64_t Percentile(const AhmLockWaitStats& heap, double fraction) {
+    uint64_t target = static_cast<uint64_t>(fraction * static_cast<double>(heap.acquisitions));
+    uint64_t seen = 0;
+    for (size_t bin = 0; bin < kLockWaitBins; ++bin) {
+        seen += heap.wait_bins[bin];
+        if (seen > target) {
+            return static_cast<uint64_t>(1) << bin;
+        }
+    }
+    return static_cast<uint64_t>(1) << (kLockWaitBins - 1);
+}
+}
+
+void WriteAhmProfileReport(const AhmProfile& profile, std::FILE* out) {
+    if (!profile.enabled) {
+        std::fprintf(out, "AHM profile: not compiled in (build with -DAHM_PROFILE=ON)\n");
+        return;
+    }
+
+    const AhmPhaseStats& phases = profile.phases;
+    uint64_t wait_ticks = 0;
+    uint64_t acquisitions = 0;
+    for (const AhmLockWaitStats& heap : profile.heaps) {
+        wait_ticks += heap.wait_ticks;
+        acquisitions += heap.acquisitions;
+    }
+    uint64_t total = phases.ticks[kPhaseMalloc] + phases.ticks[kPhaseFree];
+    // Sve sto Malloc i Free rade van merenih faza (i samo merenje).
+    uint64_t measured = wait_ticks;
+    for (size_t phase = kPhaseSelectHeap; phase < kProfilePhaseCount; ++phase) {
+        measured += phases.ticks[phase];
+    }
+
+    std::fprintf(out, "AHM profile (%s)\n", profile.tick_unit);
+    std::fprintf(out, "%-16s %14s %16s %10s %8s\n", "phase", "calls", "ticks", "avg", "share");
+    for (size_t phase = 0; phase < kProfilePhaseCount; ++phase) {
+        double share = total != 0 ? 100.0 * static_cast<double>(phases.ticks[phase]) / static_cast<double>(total) : 0.0;
+        std::fprintf(out, "%-16s %14llu %16llu %10.1f %7.1f%%\n", kPhaseNames[phase],
+            static_cast<unsigned long long>(phases.calls[phase]), static_cast<unsigned long long>(phases.ticks[phase]),
+            Average(phases.ticks[phase], phases.calls[phase]), share);
+        if (phase == kPhaseFree) {
+            double wait_share = total != 0 ? 100.0 * static_cast<double>(wait_ticks) / static_cast<double>(total) : 0.0;
+            std::fprintf(out, "%-16s %14llu %16llu %10.1f %7.1f%%\n", "lock wait",
+                static_cast<unsigned long long>(acquisitions), static_cast<unsigned long long>(wait_ticks),
+                Average(wait_ticks, acquisitions), wait_share);
+        }
+    }
+    if (total > measured) {
+        std::fprintf(out, "%-16s %14s %16llu %10s %7.1f%%\n", "other", "-",
+            static_cast<unsigned long long>(total - measured), "-",
+            100.0 * static_cast<double>(total - measured) / static_cast<double>(total));
+    }
+
+    std::fprintf(out, "%-6s %14s %12s %10s %10s %12s\n", "heap", "locks", "wait avg", "p50 <=", "p99 <=", "max <=");
+    for (size_t i = 0; i < profile.heaps.size(); ++i) {
+        const AhmLockWaitStats& heap = profile.heaps[i];
+        if (heap.acquisitions == 0) {
+            continue;
+        }
+        size_t max_bin = 0;
+        for (size_t bin = 0; bin < kLockWaitBins; ++bin) {
+            if (heap.wait_bins[bin] != 0) {
+                max_bin = bin;
+            }
+        }
+        std::fprintf(out, "%-6zu %14llu %12.1f %10llu %10llu %12llu\n", i,
+            static_cast<unsigned long long>(heap.acquisitions), Average(heap.wait_ticks, heap.acquisitions),
+            static_cast<unsigned long long>(Percentile(heap, 0.5)), static_cast<unsigned long long>(Percentile(heap, 0.99)),
+            static_cast<unsigned long long>(static_cast<uint64_t>(1) << max_bin));
+    }
+}
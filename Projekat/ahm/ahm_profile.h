@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#ifdef AHM_PROFILE
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+#endif
+
+// Profil vremena po fazama Malloc/Free i cekanja na zakljucavanje heap-ova.
+// Ukljucuje se build opcijom AHM_PROFILE (cmake -DAHM_PROFILE=ON); bez nje
+// merenja se ne prevode, a GetProfile vraca prazan profil (enabled = false).
+//
+// Vreme se meri u tick-ovima: ciklusi TSC-a (rdtsc) na x86, inace ns. Faze
+// ne obuhvataju jedna drugu (osim ukupnih Malloc i Free), ali se mere i kada
+// ih pozove druga operacija (Realloc, serije, Purge). Svako merenje dodaje
+// dva citanja casovnika, pa su kratke faze (kes niti) precenjene.
+enum AhmProfilePhase : uint8_t {
+    // Ceo javni Malloc, odnosno Free.
+    kPhaseMalloc = 0,
+    kPhaseFree,
+    // Politika balansiranja (SelectHeapIndex).
+    kPhaseSelectHeap,
+    // Uzimanje i vracanje slota iz kesa niti.
+    kPhaseThreadCache,
+    // Mapa stranica (Linux) ili mapa alokacija (Windows).
+    kPhaseMapLookup,
+    // Poziv samog heap-a: slab, arena ili HeapAlloc/HeapFree.
+    kPhaseHeapCall,
+    kProfilePhaseCount
+};
+
+// Histogram cekanja: korpa i broji cekanja od [2^(i-1), 2^i) tick-ova.
+const size_t kLockWaitBins = 40;
+
+struct AhmPhaseStats {
+    uint64_t calls[kProfilePhaseCount] = {};
+    uint64_t ticks[kProfilePhaseCount] = {};
+};
+
+// Cekanje na mutex jednog heap-a, od pokusaja do dobijanja zakljucavanja.
+struct AhmLockWaitStats {
+    uint64_t acquisitions = 0;
+    uint64_t wait_ticks = 0;
+    uint64_t wait_bins[kLockWaitBins] = {};
+};
+
+struct AhmProfile {
+    bool enabled = false;
+    const char* tick_unit = "";
+    // Zbir svih niti, i onih koje su vec zavrsile.
+    AhmPhaseStats phases;
+    std::vector<AhmLockWaitStats> heaps;
+};
+
+// Izvestaj: za svaku fazu broj merenja, ukupno i prosecno vreme i udeo u
+// vremenu Malloc+Free, a za svaki heap prosek, p50 i p99 cekanja na mutex
+// (granice korpi histograma).
+void WriteAhmProfileReport(const AhmProfile& profile, std::FILE* out);
+
+inline size_t LockWaitBin(uint64_t ticks) {
+    size_t bin = 0;
+    while (ticks != 0 && bin + 1 < kLockWaitBins) {
+        ticks >>= 1;
+        ++bin;
+    }
+    return bin;
+}
+
+// Brojaci cekanja jednog heap-a; menjaju se samo pod njegovim mutex-om.
+struct LockWaitCounters {
+    std::atomic<uint64_t> acquisitions{0};
+    std::atomic<uint64_t> wait_ticks{0};
+    std::atomic<uint64_t> wait_bins[kLockWaitBins] = {};
+
+    void Record(uint64_t ticks) {
+        Increment(acquisitions, 1);
+        Increment(wait_ticks, ticks);
+        Increment(wait_bins[LockWaitBin(ticks)], 1);
+    }
+
+    void AddTo(AhmLockWaitStats& total) const {
+        total.acquisitions += acquisitions.load(std::memory_order_relaxed);
+        total.wait_ticks += wait_ticks.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < kLockWaitBins; ++i) {
+            total.wait_bins[i] += wait_bins[i].load(std::memory_order_relaxed);
+        }
+    }
+
+private:
+    static void Increment(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+};
+
+#ifdef AHM_PROFILE
+namespace ahm_detail {
+inline uint64_t ProfileClock() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+const char* const kProfileTickUnit = "TSC cycles";
+#else
+const char* const kProfileTickUnit = "ns";
+#endif
+}
+#endif
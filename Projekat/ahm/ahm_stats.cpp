@@ -0,0 +1,223 @@
+#include "ahm_stats.h"
+
+#include <new>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+namespace {
+const size_t kMaxSlots = 4;
+
+// Slotovi niti su POD kako pristup ne bi zahtevao alokaciju (kao kod kesa niti).
+struct StatsSlot {
+    StatsControl* control;
+    ThreadStatsBlock* block;
+};
+
+thread_local StatsSlot tls_stats_slots[kMaxSlots];
+thread_local bool tls_stats_exit_registered;
+// Nit upravo kreira blok ili se gasi: alokacije iz new/delete bloka (kada je
+// menadzer malloc procesa) i posle izlaska idu u deljeni blok.
+thread_local bool tls_stats_busy;
+
+void ReleaseControl(StatsControl* control) {
+    if (control->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete control;
+    }
+}
+
+// Brojaci bloka prelaze u retired, a blok se izbacuje iz liste i oslobadja.
+void DestroySlot(StatsSlot& slot) {
+    StatsControl* control = slot.control;
+    ThreadStatsBlock* block = slot.block;
+    {
+        std::lock_guard<std::mutex> lock(control->mutex);
+        block->AddTo(control->retired);
+#ifdef AHM_PROFILE
+        block->AddPhasesTo(control->retired_phases);
+#endif
+        if (block->prev) {
+            block->prev->next = block->next;
+        } else if (control->blocks == block) {
+            control->blocks = block->next;
+        }
+        if (block->next) {
+            block->next->prev = block->prev;
+        }
+        control->block_count.fetch_sub(1, std::memory_order_relaxed);
+    }
+    // Slot se prazni pre delete, da oslobadjanje samog bloka ne zavrsi u njemu.
+    if (ahm_detail::tls_last_stats_block == block) {
+        ahm_detail::tls_last_stats_control = nullptr;
+        ahm_detail::tls_last_stats_block = nullptr;
+    }
+    slot.control = nullptr;
+    slot.block = nullptr;
+    delete block;
+    ReleaseControl(control);
+}
+
+void OnThreadExit(void*) {
+    tls_stats_busy = true;
+    for (size_t i = 0; i < kMaxSlots; ++i) {
+        if (tls_stats_slots[i].control) {
+            DestroySlot(tls_stats_slots[i]);
+        }
+    }
+}
+
+#ifdef _WIN32
+// Destruktor thread_local objekta se poziva pri izlasku niti.
+struct ThreadExitHook {
+    ~ThreadExitHook() { OnThreadExit(nullptr); }
+};
+
+void RegisterThreadExit() {
+    static thread_local ThreadExitHook hook;
+    (void)hook;
+}
+#else
+pthread_key_t g_exit_key;
+pthread_once_t g_exit_key_once = PTHREAD_ONCE_INIT;
+
+void CreateExitKey() {
+    pthread_key_create(&g_exit_key, &OnThreadExit);
+}
+
+void RegisterThreadExit() {
+    pthread_once(&g_exit_key_once, &CreateExitKey);
+    pthread_setspecific(g_exit_key, reinterpret_cast<void*>(1));
+}
+#endif
+
+// Nov blok u slobodnom slotu niti (FindThreadStats kada bloka nema).
+ThreadStatsBlock* CreateThreadStats(StatsControl* control) {
+    StatsSlot* free_slot = nullptr;
+    for (size_t i = 0; i < kMaxSlots; ++i) {
+        StatsSlot& slot = tls_stats_slots[i];
+        if (slot.control && !slot.control->alive.load(std::memory_order_acquire)) {
+            // Menadzer je unisten dok je nit ziva - slot moze ponovo da se koristi.
+            DestroySlot(slot);
+        }
+        if (!slot.control && !free_slot) {
+            free_slot = &slot;
+        }
+    }
+    if (!free_slot) {
+        return nullptr;
+    }
+
+    if (!tls_stats_exit_registered) {
+        RegisterThreadExit();
+        tls_stats_exit_registered = true;
+    }
+
+    ThreadStatsBlock* block = new (std::nothrow) ThreadStatsBlock(false);
+    if (!block) {
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(control->mutex);
+        block->thread_index = control->next_thread_index++;
+        block->next = control->blocks;
+        if (control->blocks) {
+            control->blocks->prev = block;
+        }
+        control->blocks = block;
+        control->block_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    control->references.fetch_add(1, std::memory_order_relaxed);
+    free_slot->control = control;
+    free_slot->block = block;
+    return block;
+}
+}
+
+void ThreadStatsBlock::AddTo(AhmOperationStats& total) const {
+    total.frees += frees.load(std::memory_order_relaxed);
+    total.reallocations += reallocations.load(std::memory_order_relaxed);
+    total.failed_allocations += failed_allocations.load(std::memory_order_relaxed);
+    total.requested_bytes += requested_bytes.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < kStatsSizeBins; ++i) {
+        uint64_t count = size_bins[i].load(std::memory_order_relaxed);
+        total.size_bins[i] += count;
+        total.allocations += count;
+    }
+}
+
+#ifdef AHM_PROFILE
+void ThreadStatsBlock::AddPhasesTo(AhmPhaseStats& total) const {
+    for (size_t i = 0; i < kProfilePhaseCount; ++i) {
+        total.calls[i] += phase_calls[i].load(std::memory_order_relaxed);
+        total.ticks[i] += phase_ticks[i].load(std::memory_order_relaxed);
+    }
+}
+#endif
+
+ThreadStatsBlock* FindThreadStats(StatsControl* control) {
+    ThreadStatsBlock* block = nullptr;
+    for (size_t i = 0; i < kMaxSlots && !block; ++i) {
+        if (tls_stats_slots[i].control == control) {
+            block = tls_stats_slots[i].block;
+        }
+    }
+    if (!block) {
+        if (tls_stats_busy) {
+            return &control->shared;
+        }
+        tls_stats_busy = true;
+        block = CreateThreadStats(control);
+        tls_stats_busy = false;
+        if (!block) {
+            return &control->shared;
+        }
+    }
+    // Pamti se samo sopstveni blok; DestroySlot ga brise pre oslobadjanja.
+    ahm_detail::tls_last_stats_control = control;
+    ahm_detail::tls_last_stats_block = block;
+    return block;
+}
+
+void CollectThreadStats(StatsControl* control, AhmStats& stats) {
+    for (;;) {
+        // Mesto za niz se rezervise pre zakljucavanja: alokacija pod mutex-om
+        // bi (kada je menadzer malloc procesa) mogla da kreira blok i ceka
+        // isti mutex.
+        size_t expected = control->block_count.load(std::memory_order_relaxed) + 8;
+        stats.threads.clear();
+        stats.threads.reserve(expected);
+
+        std::lock_guard<std::mutex> lock(control->mutex);
+        if (control->block_count.load(std::memory_order_relaxed) > stats.threads.capacity()) {
+            continue;
+        }
+        AhmOperationStats total = control->retired;
+        control->shared.AddTo(total);
+        for (ThreadStatsBlock* block = control->blocks; block; block = block->next) {
+            AhmThreadStats thread;
+            thread.thread_index = block->thread_index;
+            block->AddTo(thread.operations);
+            block->AddTo(total);
+            stats.threads.push_back(thread);
+        }
+        stats.operations = total;
+        return;
+    }
+}
+
+#ifdef AHM_PROFILE
+void CollectThreadPhases(StatsControl* control, AhmPhaseStats& phases) {
+    std::lock_guard<std::mutex> lock(control->mutex);
+    phases = control->retired_phases;
+    control->shared.AddPhasesTo(phases);
+    for (ThreadStatsBlock* block = control->blocks; block; block = block->next) {
+        block->AddPhasesTo(phases);
+    }
+}
+#endif
+
+void RetireStatsControl(StatsControl* control) {
+    control->alive.store(false, std::memory_order_release);
+    ReleaseControl(control);
+}
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "ahm_profile.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Statistika menadzera (BasicHeapManager::GetStats, ahm_get_stats).
+//
+// Brojace operacija vodi svaka nit u svom bloku, posebno za svaki menadzer:
+// menja ih samo ta nit, relaksiranim citanjem i upisom (bez instrukcija sa
+// lock prefiksom i bez deljenih linija kesa), a sabiraju se tek pri citanju
+// statistike. Zauzece i zakljucavanja vodi svaki heap pored svog brojaca
+// bajtova i mutex-a, pa i oni ne dodaju deljene upise.
+
+// Histogram velicina zahteva: korpa i broji zahteve velicine (2^(i-1), 2^i],
+// korpa 0 zahteve od 0 i 1 bajta, a poslednja sve vece.
+const size_t kStatsSizeBins = 40;
+
+inline size_t StatsSizeBin(size_t size) {
+    if (size <= 1) {
+        return 0;
+    }
+    unsigned long long value = static_cast<unsigned long long>(size - 1);
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanReverse64(&index, value);
+    size_t bin = static_cast<size_t>(index) + 1;
+#else
+    size_t bin = static_cast<size_t>(64 - __builtin_clzll(value));
+#endif
+    return bin < kStatsSizeBins ? bin : kStatsSizeBins - 1;
+}
+
+// Brojaci javnih operacija. Realloc postojeceg bloka je reallocation, a
+// Realloc(nullptr, n) i Realloc(p, 0) se broje kao alokacija, odnosno
+// oslobadjanje. Histogram broji trazene velicine alokacija, a
+// requested_bytes zbir velicina alokacija i realokacija.
+struct AhmOperationStats {
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t reallocations = 0;
+    // Pozivi koji nisu dobili memoriju (kod serije: serija koja nije cela uspela).
+    uint64_t failed_allocations = 0;
+    uint64_t requested_bytes = 0;
+    uint64_t size_bins[kStatsSizeBins] = {};
+};
+
+struct AhmThreadStats {
+    // Redni broj niti po prvoj operaciji nad menadzerom.
+    uint64_t thread_index = 0;
+    AhmOperationStats operations;
+};
+
+// Zauzece heap-a se vodi po upotrebljivoj velicini blokova; blokovi u
+// kesevima niti su zauzeti. Zakljucavanje je sporno kada ga nit nije dobila
+// iz prvog pokusaja (i kada je zbog toga oslobadjanje odlozeno).
+struct AhmHeapStats {
+    size_t live_bytes = 0;
+    size_t peak_bytes = 0;
+    uint64_t lock_acquisitions = 0;
+    uint64_t contended_locks = 0;
+};
+
+struct AhmStats {
+    // Zbir svih niti, i onih koje su vec zavrsile.
+    AhmOperationStats operations;
+    size_t live_bytes = 0;
+    // Zbir vrhova heap-ova: gornja granica vrha celog menadzera, jer heap-ovi
+    // ne dostizu vrh u istom trenutku (tacan zbir bi trazio deljeni brojac).
+    size_t peak_bytes = 0;
+    uint64_t lock_acquisitions = 0;
+    uint64_t contended_locks = 0;
+    std::vector<AhmHeapStats> heaps;
+    // Samo niti koje su jos zive.
+    std::vector<AhmThreadStats> threads;
+};
+
+// Brojaci jedne niti za jedan menadzer. Deljeni blok (shared) koriste niti
+// koje nemaju svoj (vise menadzera nego slotova, ili alokacija iz samog
+// kreiranja bloka); on se menja atomicnim sabiranjem.
+struct alignas(64) ThreadStatsBlock {
+    explicit ThreadStatsBlock(bool shared_block) : shared(shared_block) {}
+
+    ThreadStatsBlock(const ThreadStatsBlock&) = delete;
+    ThreadStatsBlock& operator=(const ThreadStatsBlock&) = delete;
+
+    void OnAllocations(size_t size, size_t count) {
+        if (shared) {
+            AddAllocations<true>(size, count);
+        } else {
+            AddAllocations<false>(size, count);
+        }
+    }
+    void OnReallocation(size_t size) {
+        if (shared) {
+            Add<true>(reallocations, 1);
+            Add<true>(requested_bytes, size);
+        } else {
+            Add<false>(reallocations, 1);
+            Add<false>(requested_bytes, size);
+        }
+    }
+    void OnFailedAllocation() {
+        if (shared) {
+            Add<true>(failed_allocations, 1);
+        } else {
+            Add<false>(failed_allocations, 1);
+        }
+    }
+    void OnFrees(size_t count) {
+        if (shared) {
+            Add<true>(frees, count);
+        } else {
+            Add<false>(frees, count);
+        }
+    }
+
+    // Dodaje brojace bloka u total (citanje sme iz bilo koje niti).
+    void AddTo(AhmOperationStats& total) const;
+
+#ifdef AHM_PROFILE
+    void OnPhase(AhmProfilePhase phase, uint64_t ticks) {
+        if (shared) {
+            Add<true>(phase_calls[phase], 1);
+            Add<true>(phase_ticks[phase], ticks);
+        } else {
+            Add<false>(phase_calls[phase], 1);
+            Add<false>(phase_ticks[phase], ticks);
+        }
+    }
+    void AddPhasesTo(AhmPhaseStats& total) const;
+
+    std::atomic<uint64_t> phase_calls[kProfilePhaseCount] = {};
+    std::atomic<uint64_t> phase_ticks[kProfilePhaseCount] = {};
+#endif
+
+    // Broj alokacija je zbir histograma, pa se ne vodi posebno.
+    std::atomic<uint64_t> frees{0};
+    std::atomic<uint64_t> reallocations{0};
+    std::atomic<uint64_t> failed_allocations{0};
+    std::atomic<uint64_t> requested_bytes{0};
+    std::atomic<uint64_t> size_bins[kStatsSizeBins] = {};
+
+    const bool shared;
+    uint64_t thread_index = 0;
+    // Veza u listi blokova kontrolnog bloka.
+    ThreadStatsBlock* next = nullptr;
+    ThreadStatsBlock* prev = nullptr;
+
+private:
+    template <bool kShared>
+    static void Add(std::atomic<uint64_t>& counter, uint64_t value) {
+        if (kShared) {
+            counter.fetch_add(value, std::memory_order_relaxed);
+        } else {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+    }
+
+    template <bool kShared>
+    void AddAllocations(size_t size, size_t count) {
+        Add<kShared>(requested_bytes, static_cast<uint64_t>(size) * count);
+        Add<kShared>(size_bins[StatsSizeBin(size)], count);
+    }
+};
+
+// Deljeni kontrolni blok menadzera i niti koje vode brojace za njega (isti
+// model kao ThreadCacheControl): nit pri izlasku dodaje svoje brojace u
+// retired, a referenca sprecava da novi menadzer dobije istu adresu dok neka
+// nit jos drzi blok starog.
+struct StatsControl {
+    std::mutex mutex;
+    std::atomic<bool> alive{true};
+    std::atomic<size_t> references{1};
+    ThreadStatsBlock* blocks = nullptr;
+    std::atomic<size_t> block_count{0};
+    uint64_t next_thread_index = 0;
+    // Zbir niti koje su zavrsile (pod mutex-om).
+    AhmOperationStats retired;
+#ifdef AHM_PROFILE
+    AhmPhaseStats retired_phases;
+#endif
+    ThreadStatsBlock shared{true};
+};
+
+namespace ahm_detail {
+// Poslednji par (kontrolni blok, blok niti) koji je nit koristila: uobicajen
+// slucaj, jedan menadzer, ne prolazi kroz slotove.
+inline thread_local StatsControl* tls_last_stats_control = nullptr;
+inline thread_local ThreadStatsBlock* tls_last_stats_block = nullptr;
+}
+
+// Spori deo GetThreadStats: trazi (ili kreira) blok u slotovima niti.
+ThreadStatsBlock* FindThreadStats(StatsControl* control);
+
+// Blok trenutne niti za dati kontrolni blok (kreira ga pri prvom pristupu);
+// nikad nullptr - ako nit ne moze da dobije svoj blok, vraca deljeni.
+inline ThreadStatsBlock* GetThreadStats(StatsControl* control) {
+    if (ahm_detail::tls_last_stats_control == control) {
+        return ahm_detail::tls_last_stats_block;
+    }
+    return FindThreadStats(control);
+}
+
+// Popunjava operations i threads (zive niti, zbir i zavrsenih).
+void CollectThreadStats(StatsControl* control, AhmStats& stats);
+#ifdef AHM_PROFILE
+// Zbir faza profila svih niti.
+void CollectThreadPhases(StatsControl* control, AhmPhaseStats& phases);
+#endif
+
+// Poziva menadzer u destruktoru: referenca menadzera se pusta.
+void RetireStatsControl(StatsControl* control);
@@ -0,0 +1,183 @@
+#include "ahm_trace.h"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// Kursor niti u njenom chunk-u. Vezan je za generaciju traga, pa nit koja
+// zapise prvi put u novi trag (ili posle njegovog unistenja) uzima nov chunk.
+struct TraceCursor {
+    uint64_t generation;
+    AhmTraceRecord* next;
+    AhmTraceRecord* end;
+    uint64_t thread_bits;
+};
+
+thread_local TraceCursor tls_trace_cursor = {0, nullptr, nullptr, 0};
+std::atomic<uint64_t> g_trace_generation{0};
+
+#ifndef _WIN32
+// Posle fork-a dete deli mapiranje fajla sa roditeljem, a njegova kopija
+// brojaca chunk-ova zastari, pa bi upisivalo preko roditelja: dete zato samo
+// broji izgubljene dogadjaje. Kursor niti koja je pozvala fork se prazni.
+bool g_trace_forked = false;
+
+void StopTracingInChild() {
+    g_trace_forked = true;
+    tls_trace_cursor.next = nullptr;
+    tls_trace_cursor.end = nullptr;
+}
+#endif
+
+int64_t SteadyNanoseconds() {
+    return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+}
+
+AhmTraceRecorder::AhmTraceRecorder(const char* path, size_t capacity_bytes)
+    : base_(nullptr),
+      mapped_bytes_(0),
+      chunk_capacity_(0),
+      generation_(g_trace_generation.fetch_add(1, std::memory_order_relaxed) + 1),
+      start_ns_(SteadyNanoseconds()) {
+    if (!path || !*path) {
+        throw std::invalid_argument("trace path must not be empty");
+    }
+    if (capacity_bytes < kTraceHeaderBytes + kTraceChunkBytes) {
+        throw std::invalid_argument("trace capacity is too small");
+    }
+    chunk_capacity_ = (capacity_bytes - kTraceHeaderBytes) / kTraceChunkBytes;
+    mapped_bytes_ = kTraceHeaderBytes + chunk_capacity_ * kTraceChunkBytes;
+
+#ifdef _WIN32
+    file_ = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("trace file could not be created");
+    }
+    uint64_t size = mapped_bytes_;
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+    void* view = mapping_ ? MapViewOfFile(mapping_, FILE_MAP_WRITE, 0, 0, mapped_bytes_) : nullptr;
+    if (!view) {
+        if (mapping_) {
+            CloseHandle(mapping_);
+        }
+        CloseHandle(file_);
+        throw std::runtime_error("trace file could not be mapped");
+    }
+#else
+    static const int fork_handler = pthread_atfork(nullptr, nullptr, &StopTracingInChild);
+    (void)fork_handler;
+    fd_ = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("trace file could not be created");
+    }
+    // Fajl je redak (sparse): disk zauzimaju samo chunk-ovi koje niti uzmu.
+    void* view = MAP_FAILED;
+    if (ftruncate(fd_, static_cast<off_t>(mapped_bytes_)) == 0) {
+        view = mmap(nullptr, mapped_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd_, 0);
+    }
+    if (view == MAP_FAILED) {
+        close(fd_);
+        throw std::runtime_error("trace file could not be mapped");
+    }
+#endif
+    base_ = static_cast<unsigned char*>(view);
+
+    AhmTraceHeader header{};
+    std::memcpy(header.magic, kTraceMagic, sizeof(header.magic));
+    header.version = kTraceVersion;
+    header.chunk_bytes = static_cast<uint32_t>(kTraceChunkBytes);
+    std::memcpy(base_, &header, sizeof(header));
+}
+
+AhmTraceRecorder::~AhmTraceRecorder() {
+    size_t chunk_count = next_chunk_.load(std::memory_order_relaxed);
+    if (chunk_count > chunk_capacity_) {
+        chunk_count = chunk_capacity_;
+    }
+    AhmTraceHeader header{};
+    std::memcpy(&header, base_, sizeof(header));
+    header.chunk_count = chunk_count;
+    header.thread_count = next_thread_.load(std::memory_order_relaxed);
+    header.dropped_events = dropped_.load(std::memory_order_relaxed);
+    std::memcpy(base_, &header, sizeof(header));
+
+    size_t used_bytes = kTraceHeaderBytes + chunk_count * kTraceChunkBytes;
+#ifdef _WIN32
+    UnmapViewOfFile(base_);
+    CloseHandle(mapping_);
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(used_bytes);
+    if (SetFilePointerEx(file_, end, nullptr, FILE_BEGIN)) {
+        SetEndOfFile(file_);
+    }
+    CloseHandle(file_);
+#else
+    munmap(base_, mapped_bytes_);
+    if (ftruncate(fd_, static_cast<off_t>(used_bytes)) != 0) {
+        // Fajl ostaje pune velicine; citac preskace prazne chunk-ove.
+    }
+    close(fd_);
+#endif
+}
+
+uint64_t AhmTraceRecorder::Now() const {
+    return static_cast<uint64_t>(SteadyNanoseconds() - start_ns_);
+}
+
+void AhmTraceRecorder::Record(AhmTraceEvent event, const void* address, size_t size, uint64_t time, size_t alignment) {
+    TraceCursor& cursor = tls_trace_cursor;
+    if (cursor.generation != generation_) {
+        cursor.generation = generation_;
+        cursor.next = nullptr;
+        cursor.end = nullptr;
+        cursor.thread_bits = static_cast<uint64_t>(next_thread_.fetch_add(1, std::memory_order_relaxed) & 0xFFFF) << 48;
+    }
+    if (cursor.next == cursor.end && !NextChunk()) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    uint64_t alignment_log2 = 0;
+    while ((static_cast<size_t>(1) << alignment_log2) < alignment) {
+        ++alignment_log2;
+    }
+    AhmTraceRecord* record = cursor.next++;
+    record->time_and_event = (static_cast<uint64_t>(event) << 56) | (alignment_log2 << 48) | (time & AhmTraceRecord::kLowMask);
+    record->address_and_thread = cursor.thread_bits | (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(address)) & AhmTraceRecord::kLowMask);
+    record->size = size;
+}
+
+uint64_t AhmTraceRecorder::DroppedEvents() const {
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+bool AhmTraceRecorder::NextChunk() {
+    // Pun fajl se proverava citanjem, da izgubljeni dogadjaji ne bi svi
+    // udarali u isti brojac fetch_add-om.
+    if (next_chunk_.load(std::memory_order_relaxed) >= chunk_capacity_) {
+        return false;
+    }
+#ifndef _WIN32
+    if (g_trace_forked) {
+        return false;
+    }
+#endif
+    size_t chunk = next_chunk_.fetch_add(1, std::memory_order_relaxed);
+    if (chunk >= chunk_capacity_) {
+        return false;
+    }
+    TraceCursor& cursor = tls_trace_cursor;
+    cursor.next = reinterpret_cast<AhmTraceRecord*>(base_ + kTraceHeaderBytes + chunk * kTraceChunkBytes);
+    cursor.end = cursor.next + kTraceChunkBytes / sizeof(AhmTraceRecord);
+    return true;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Binarni trag alokacija (Config::trace_path) koji cita alat ahm_replay.
+//
+// Fajl pocinje zaglavljem od kTraceHeaderBytes, a zatim slede chunk-ovi od
+// kTraceChunkBytes. Svaka nit uzima ceo chunk i u njega upisuje zapise bez
+// zakljucavanja; neiskorisceni kraj chunk-a (i chunk-ovi koje niko nije uzeo)
+// ostaju nule, pa ih citac preskace. Zapisi unutar chunk-a su poredjani po
+// vremenu, a izmedju niti redosled daje vremenska oznaka.
+enum AhmTraceEvent : uint8_t {
+    kTraceEmpty = 0,
+    kTraceMalloc = 1,
+    kTraceCalloc = 2,
+    kTraceFree = 3,
+    // Realloc daje dva zapisa: stara adresa sa vremenom pre poziva i nova
+    // adresa sa vremenom posle njega.
+    kTraceReallocFrom = 4,
+    kTraceRealloc = 5,
+};
+
+// Zapis od 24 bajta. Vreme (ns od pocetka traga) i adresa zauzimaju nizih 48
+// bitova svoje reci; iznad vremena su dogadjaj i log2 poravnanja (0 za obicne
+// alokacije), a iznad adrese redni broj niti.
+struct AhmTraceRecord {
+    uint64_t time_and_event;
+    uint64_t address_and_thread;
+    uint64_t size;
+
+    static const uint64_t kLowMask = (1ull << 48) - 1;
+
+    AhmTraceEvent Event() const { return static_cast<AhmTraceEvent>(time_and_event >> 56); }
+    unsigned AlignmentLog2() const { return static_cast<unsigned>((time_and_event >> 48) & 0xFF); }
+    uint64_t Time() const { return time_and_event & kLowMask; }
+    uint64_t Address() const { return address_and_thread & kLowMask; }
+    unsigned Thread() const { return static_cast<unsigned>(address_and_thread >> 48); }
+};
+
+struct AhmTraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t chunk_bytes;
+    // Popunjava se pri zatvaranju; 0 znaci da proces nije uredno zatvorio trag
+    // (npr. LD_PRELOAD), pa citac broji chunk-ove iz velicine fajla.
+    uint64_t chunk_count;
+    uint64_t thread_count;
+    uint64_t dropped_events;
+};
+
+const char kTraceMagic[8] = {'A', 'H', 'M', 'T', 'R', 'A', 'C', 'E'};
+const uint32_t kTraceVersion = 1;
+const size_t kTraceHeaderBytes = 4096;
+const size_t kTraceChunkBytes = 64 * 1024;
+
+// Upisuje zapise kroz mapiranje fajla: nit drzi kursor u svom chunk-u
+// (thread_local), pa zapis kosta jedno citanje casovnika i tri upisa. Kada
+// fajl (capacity_bytes) ostane bez chunk-ova, dogadjaji se samo broje.
+// Niti se numerisu redom prvog zapisa; posle 65536 niti brojevi se ponavljaju.
+class AhmTraceRecorder {
+public:
+    // Baca std::runtime_error ako fajl ne moze da se kreira ili mapira.
+    AhmTraceRecorder(const char* path, size_t capacity_bytes);
+    // Upisuje zaglavlje i skracuje fajl na iskorisceni deo.
+    ~AhmTraceRecorder();
+
+    AhmTraceRecorder(const AhmTraceRecorder&) = delete;
+    AhmTraceRecorder& operator=(const AhmTraceRecorder&) = delete;
+
+    // Nanosekunde od kreiranja traga.
+    uint64_t Now() const;
+    void Record(AhmTraceEvent event, const void* address, size_t size, uint64_t time, size_t alignment = 0);
+
+    uint64_t DroppedEvents() const;
+
+private:
+    // Uzima novi chunk za tekucu nit; false ako u fajlu vise nema mesta.
+    bool NextChunk();
+
+    unsigned char* base_;
+    size_t mapped_bytes_;
+    size_t chunk_capacity_;
+    uint64_t generation_;
+    int64_t start_ns_;
+    std::atomic<size_t> next_chunk_{0};
+    std::atomic<uint32_t> next_thread_{0};
+    std::atomic<uint64_t> dropped_{0};
+#ifdef _WIN32
+    HANDLE file_;
+    HANDLE mapping_;
+#else
+    int fd_;
+#endif
+};
@@ -2,16 +2,32 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define AHM_ALLOCATION_MAP_SSE2 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 // Jednostavna hash mapa (bez STL map/list) za mapiranje adresa na vrednosti.
+// Raspored po uzoru na Swiss table: kapacitet je stepen dvojke, a pored niza
+// slotova postoji niz kontrolnih bajtova (prazan / obrisan / 7 bita hash-a).
+// Pretraga poredi po 16 kontrolnih bajtova odjednom (SSE2), pa se kljucevi
+// citaju samo za slotove ciji se bitovi hash-a poklapaju.
 template <typename TValue>
 class AllocationMap {
 public:
-    AllocationMap() : entries_(nullptr), capacity_(0), size_(0), tombstones_(0) {
-        Rehash(32);
+    AllocationMap()
+        : ctrl_(nullptr), entries_(nullptr), capacity_(0), size_(0), tombstones_(0), growth_left_(0) {
+        Rehash(kMinCapacity);
     }
 
     ~AllocationMap() {
+        delete[] ctrl_;
         delete[] entries_;
     }
 
@@ -19,106 +35,188 @@ public:
     AllocationMap& operator=(const AllocationMap&) = delete;
 
     void Insert(void* key, const TValue& value) {
-        if ((size_ + tombstones_ + 1) * 10 >= capacity_ * 7) {
-            Rehash(capacity_ * 2);
+        size_t hash = Hash(key);
+        size_t index = FindIndex(key, hash);
+        if (index != capacity_) {
+            entries_[index].value = value;
+            return;
         }
 
-        size_t index = Hash(key) % capacity_;
-        size_t first_tombstone = capacity_;
-        while (entries_[index].occupied) {
-            if (entries_[index].key == key) {
-                entries_[index].value = value;
-                return;
-            }
-            if (entries_[index].tombstone && first_tombstone == capacity_) {
-                first_tombstone = index;
-            }
-            index = (index + 1) % capacity_;
+        index = FindInsertSlot(hash);
+        if (ctrl_[index] == kEmpty && growth_left_ == 0) {
+            // Ako su vecinu zauzeca napravili obrisani slotovi, dovoljno ih je
+            // ocistiti na istom kapacitetu; inace se kapacitet udvostrucuje.
+            Rehash(size_ * 16 <= capacity_ * 7 ? capacity_ : capacity_ * 2);
+            index = FindInsertSlot(hash);
         }
 
-        size_t target = (first_tombstone == capacity_) ? index : first_tombstone;
-        entries_[target].key = key;
-        entries_[target].value = value;
-        entries_[target].occupied = true;
-        if (entries_[target].tombstone) {
-            entries_[target].tombstone = false;
-            if (tombstones_ > 0) {
-                --tombstones_;
-            }
+        if (ctrl_[index] == kEmpty) {
+            --growth_left_;
+        } else {
+            --tombstones_;
         }
+        ctrl_[index] = H2(hash);
+        entries_[index].key = key;
+        entries_[index].value = value;
         ++size_;
     }
 
     bool Find(void* key, TValue& value) const {
-        if (capacity_ == 0) {
+        size_t index = FindIndex(key, Hash(key));
+        if (index == capacity_) {
             return false;
         }
-        size_t index = Hash(key) % capacity_;
-        size_t start = index;
-        while (entries_[index].occupied) {
-            if (!entries_[index].tombstone && entries_[index].key == key) {
-                value = entries_[index].value;
-                return true;
-            }
-            index = (index + 1) % capacity_;
-            if (index == start) {
-                break;
-            }
-        }
-        return false;
+        value = entries_[index].value;
+        return true;
     }
 
     bool Erase(void* key) {
-        if (capacity_ == 0) {
+        size_t index = FindIndex(key, Hash(key));
+        if (index == capacity_) {
             return false;
         }
-        size_t index = Hash(key) % capacity_;
-        size_t start = index;
-        while (entries_[index].occupied) {
-            if (!entries_[index].tombstone && entries_[index].key == key) {
-                entries_[index].tombstone = true;
-                if (size_ > 0) {
-                    --size_;
-                }
-                ++tombstones_;
-                return true;
-            }
-            index = (index + 1) % capacity_;
-            if (index == start) {
-                break;
-            }
+
+        // Ako grupa ima prazan slot, nijedna pretraga nije prosla kroz nju,
+        // pa se slot vraca kao prazan umesto da ostane obrisan (tombstone).
+        size_t group = index & ~(kGroupWidth - 1);
+        if (MatchEmpty(group) != 0) {
+            ctrl_[index] = kEmpty;
+            ++growth_left_;
+        } else {
+            ctrl_[index] = kDeleted;
+            ++tombstones_;
+        }
+        --size_;
+
+        // Mapa se smanjuje kada ostane skoro prazna; posle smanjenja je
+        // popunjena najvise do 1/4, pa se ne smenjuje stalno sa rastom.
+        if (capacity_ > kMinCapacity && size_ * 16 < capacity_) {
+            Rehash(capacity_ / 4 > kMinCapacity ? capacity_ / 4 : kMinCapacity);
         }
-        return false;
+        return true;
     }
 
 private:
+    static const size_t kGroupWidth = 16;
+    static const size_t kMinCapacity = 32;
+    static const uint8_t kEmpty = 0x80;
+    static const uint8_t kDeleted = 0xFE;
+
     struct Entry {
         void* key = nullptr;
         TValue value{};
-        bool occupied = false;
-        bool tombstone = false;
     };
 
+    // Visih 57 bita bira grupu, nizih 7 se cuva u kontrolnom bajtu.
+    static size_t H1(size_t hash) { return hash >> 7; }
+    static uint8_t H2(size_t hash) { return static_cast<uint8_t>(hash & 0x7F); }
+
+    // Bit i maske je postavljen ako kontrolni bajt group + i ispunjava uslov.
+    uint32_t Match(size_t group, uint8_t value) const {
+#ifdef AHM_ALLOCATION_MAP_SSE2
+        __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl_ + group));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(static_cast<char>(value)))));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < kGroupWidth; ++i) {
+            if (ctrl_[group + i] == value) {
+                mask |= 1u << i;
+            }
+        }
+        return mask;
+#endif
+    }
+
+    uint32_t MatchEmpty(size_t group) const { return Match(group, kEmpty); }
+
+    // Slobodni slotovi (prazni ili obrisani) imaju postavljen najvisi bit.
+    uint32_t MatchFree(size_t group) const {
+#ifdef AHM_ALLOCATION_MAP_SSE2
+        __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl_ + group));
+        return static_cast<uint32_t>(_mm_movemask_epi8(ctrl));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < kGroupWidth; ++i) {
+            if (ctrl_[group + i] & 0x80) {
+                mask |= 1u << i;
+            }
+        }
+        return mask;
+#endif
+    }
+
+    static size_t LowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return static_cast<size_t>(__builtin_ctz(mask));
+#endif
+    }
+
+    // Indeks slota sa kljucem ili capacity_ ako kljuc ne postoji.
+    // Grupe se obilaze trougaonim koracima, sto za broj grupa koji je stepen
+    // dvojke obilazi svaku grupu tacno jednom.
+    size_t FindIndex(void* key, size_t hash) const {
+        size_t group_mask = capacity_ / kGroupWidth - 1;
+        size_t group = H1(hash) & group_mask;
+        uint8_t h2 = H2(hash);
+        for (size_t step = 1; step <= group_mask + 1; ++step) {
+            size_t base = group * kGroupWidth;
+            for (uint32_t mask = Match(base, h2); mask != 0; mask &= mask - 1) {
+                size_t index = base + LowestBit(mask);
+                if (entries_[index].key == key) {
+                    return index;
+                }
+            }
+            if (MatchEmpty(base) != 0) {
+                break;
+            }
+            group = (group + step) & group_mask;
+        }
+        return capacity_;
+    }
+
+    // Prvi prazan ili obrisan slot na putanji pretrage za hash.
+    size_t FindInsertSlot(size_t hash) const {
+        size_t group_mask = capacity_ / kGroupWidth - 1;
+        size_t group = H1(hash) & group_mask;
+        for (size_t step = 1;; ++step) {
+            size_t base = group * kGroupWidth;
+            uint32_t mask = MatchFree(base);
+            if (mask != 0) {
+                return base + LowestBit(mask);
+            }
+            group = (group + step) & group_mask;
+        }
+    }
+
     void Rehash(size_t new_capacity) {
+        uint8_t* old_ctrl = ctrl_;
         Entry* old_entries = entries_;
         size_t old_capacity = capacity_;
 
+        ctrl_ = new uint8_t[new_capacity];
         entries_ = new Entry[new_capacity];
+        std::memset(ctrl_, kEmpty, new_capacity);
         capacity_ = new_capacity;
-        size_ = 0;
         tombstones_ = 0;
+        growth_left_ = new_capacity - new_capacity / 8 - size_;
 
-        if (old_entries) {
-            for (size_t i = 0; i < old_capacity; ++i) {
-                if (old_entries[i].occupied && !old_entries[i].tombstone) {
-                    Insert(old_entries[i].key, old_entries[i].value);
-                }
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (!(old_ctrl[i] & 0x80)) {
+                size_t hash = Hash(old_entries[i].key);
+                size_t index = FindInsertSlot(hash);
+                ctrl_[index] = H2(hash);
+                entries_[index] = old_entries[i];
             }
-            delete[] old_entries;
         }
+        delete[] old_ctrl;
+        delete[] old_entries;
     }
 
-    size_t Hash(void* key) const {
+    static size_t Hash(void* key) {
         size_t value = static_cast<size_t>(reinterpret_cast<uintptr_t>(key));
         value ^= (value >> 33);
         value *= 0xff51afd7ed558ccdULL;
@@ -126,8 +224,11 @@ private:
         return value;
     }
 
+    uint8_t* ctrl_;
     Entry* entries_;
     size_t capacity_;
     size_t size_;
     size_t tombstones_;
+    // Broj praznih slotova koji se jos mogu popuniti pre prekoracenja 7/8.
+    size_t growth_left_;
 };
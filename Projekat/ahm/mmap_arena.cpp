@@ -0,0 +1,819 @@
+#ifndef _WIN32
+
+#include "mmap_arena.h"
+
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+size_t RoundUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+int FloorLog2(size_t value) {
+    return 63 - __builtin_clzll(static_cast<unsigned long long>(value));
+}
+
+#if UINTPTR_MAX > 0xFFFFFFFFu
+// Poravnate adrese koje se predlazu mmap-u (kao u mimalloc-u): dok je opseg
+// slobodan, kernel mapira tacno tu, pa je poravnat region jedan poziv umesto
+// tri (mmap viska i dva munmap). Opseg od 32 do 64 TiB je daleko od heap-a,
+// biblioteka i steka, i deli se na slotove od kSegmentSize. Predlaze se samo
+// za regione koji staju u slot (segmenti), a slot oslobodjenog regiona se
+// ponovo koristi pre novog, pa churn ne trosi nove adrese (ni listove mape
+// stranica). Veci regioni idu na adrese koje bira kernel.
+const uintptr_t kHintStart = static_cast<uintptr_t>(32) << 40;
+const uintptr_t kHintEnd = static_cast<uintptr_t>(64) << 40;
+const size_t kFreeHintSlots = 1024;
+
+std::mutex g_hint_mutex;
+uintptr_t g_next_hint = kHintStart;
+uintptr_t g_free_hints[kFreeHintSlots];
+size_t g_free_hint_count = 0;
+
+void* MapHinted(size_t size, size_t alignment, int flags) {
+    if (size > MmapArena::kSegmentSize || alignment != MmapArena::kSegmentSize) {
+        return nullptr;
+    }
+    uintptr_t hint = 0;
+    {
+        std::lock_guard<std::mutex> lock(g_hint_mutex);
+        if (g_free_hint_count > 0) {
+            hint = g_free_hints[--g_free_hint_count];
+        } else {
+            if (g_next_hint >= kHintEnd) {
+                g_next_hint = kHintStart;
+            }
+            hint = g_next_hint;
+            g_next_hint += MmapArena::kSegmentSize;
+        }
+    }
+    void* raw = mmap(reinterpret_cast<void*>(hint), size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (raw == MAP_FAILED) {
+        return nullptr;
+    }
+    if ((reinterpret_cast<uintptr_t>(raw) & (alignment - 1)) != 0) {
+        munmap(raw, size);
+        return nullptr;
+    }
+    return raw;
+}
+
+// Region [memory, memory + size) vise nije mapiran: ako je zauzimao slot
+// predloga, slot se vraca za sledeci segment.
+void ReleaseHint(void* memory, size_t size) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(memory);
+    if (size > MmapArena::kSegmentSize || address < kHintStart || address >= kHintEnd ||
+        (address & (MmapArena::kSegmentSize - 1)) != 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(g_hint_mutex);
+    if (g_free_hint_count < kFreeHintSlots) {
+        g_free_hints[g_free_hint_count++] = address;
+    }
+}
+#else
+void* MapHinted(size_t, size_t, int) {
+    return nullptr;
+}
+
+void ReleaseHint(void*, size_t) {}
+#endif
+
+void UnmapAligned(void* memory, size_t size) {
+    munmap(memory, size);
+    ReleaseHint(memory, size);
+}
+
+// mmap regiona poravnatog na zadatu granicu: prvo na predlozenoj adresi, a
+// inace se mapira visak pa se odsece. Sa huge_pages se prvo pokusava
+// MAP_HUGETLB (size i alignment su tada umnozak velike stranice, pa su i
+// odsecanja poravnata na nju).
+void* MapAligned(size_t size, size_t alignment, bool huge_pages) {
+    size_t request = size + alignment;
+    void* raw = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (huge_pages) {
+        void* hinted = MapHinted(size, alignment, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB);
+        if (hinted) {
+            return hinted;
+        }
+        raw = mmap(nullptr, request, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+#endif
+    bool transparent = false;
+    if (raw == MAP_FAILED) {
+        transparent = huge_pages;
+        void* hinted = MapHinted(size, alignment, MAP_PRIVATE | MAP_ANONYMOUS);
+        if (hinted) {
+            raw = hinted;
+            request = size;
+        } else {
+            raw = mmap(nullptr, request, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw == MAP_FAILED) {
+                return nullptr;
+            }
+        }
+    }
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = (start + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    size_t head = aligned - start;
+    size_t tail = request - head - size;
+    if (head > 0) {
+        munmap(raw, head);
+    }
+    if (tail > 0) {
+        munmap(reinterpret_cast<void*>(aligned + size), tail);
+    }
+#ifdef MADV_HUGEPAGE
+    if (transparent) {
+        madvise(reinterpret_cast<void*>(aligned), size, MADV_HUGEPAGE);
+    }
+#else
+    (void)transparent;
+#endif
+    return reinterpret_cast<void*>(aligned);
+}
+}
+
+MmapArena::MmapArena(size_t heap_index, PageMap* page_map, size_t initial_size_bytes, size_t maximum_size_bytes,
+    bool huge_pages, size_t large_threshold, size_t large_cache_bytes)
+    : fl_bitmap_(0), segments_(nullptr), large_cache_(nullptr), large_cache_bytes_(large_cache_bytes), cached_bytes_(0),
+      cached_count_(0), heap_index_(heap_index), page_map_(page_map), mapped_bytes_(0),
+      maximum_bytes_(RoundUp(maximum_size_bytes, kPageSize)), huge_pages_(huge_pages), clock_(0) {
+    static_assert(sizeof(Segment) == kRawSegmentOffset, "segment header size mismatch");
+    // Blok koji ne staje u segment uvek dobija sopstveni.
+    large_chunk_ = kMaxSegmentChunk + 1;
+    if (large_threshold != 0 && large_threshold <= kMaxSegmentChunk) {
+        large_chunk_ = ChunkSizeFor(large_threshold);
+    }
+    // Velike stranice se vracaju samo cele (MAP_HUGETLB drugacije ne dozvoljava).
+    purge_page_ = huge_pages_ ? kHugePageSize : static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    min_purge_chunk_ = 2 * purge_page_;
+    std::memset(blocks_, 0, sizeof(blocks_));
+    std::memset(sl_bitmap_, 0, sizeof(sl_bitmap_));
+
+    if (maximum_bytes_ != 0 && initial_size_bytes > maximum_bytes_) {
+        throw std::invalid_argument("initial_size_bytes must not exceed maximum_size_bytes");
+    }
+
+    // Inicijalna velicina se odmah mapira u segmentima.
+    if (!Reserve(initial_size_bytes)) {
+        ReleaseAll();
+        throw std::runtime_error("mmap failed");
+    }
+}
+
+MmapArena::~MmapArena() {
+    ReleaseAll();
+}
+
+void MmapArena::LockForFork() {
+#if UINTPTR_MAX > 0xFFFFFFFFu
+    g_hint_mutex.lock();
+#endif
+}
+
+void MmapArena::UnlockAfterFork() {
+#if UINTPTR_MAX > 0xFFFFFFFFu
+    g_hint_mutex.unlock();
+#endif
+}
+
+void MmapArena::PopulatePages(void* start, size_t size) {
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(start, size, MADV_POPULATE_WRITE) == 0) {
+        return;
+    }
+#endif
+    // Kernel pre 5.14: upis na svaku stranicu (sadrzaj slobodnog bloka se ne menja).
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    volatile char* bytes = static_cast<volatile char*>(start);
+    for (size_t offset = 0; offset < size; offset += page) {
+        bytes[offset] = bytes[offset];
+    }
+}
+
+bool MmapArena::Reserve(size_t bytes) {
+    if (bytes > SIZE_MAX - kPageSize) {
+        return false;
+    }
+    size_t target = RoundUp(bytes, kPageSize);
+    while (mapped_bytes_ < target) {
+        size_t segment_size = target - mapped_bytes_;
+        if (segment_size > kSegmentSize) {
+            segment_size = kSegmentSize;
+        }
+        Chunk* chunk = AddSegment(segment_size);
+        if (!chunk) {
+            return false;
+        }
+        InsertFree(chunk);
+        if (ChunkSize(chunk) >= min_purge_chunk_) {
+            // Sveze mapirane stranice jos nisu u memoriji.
+            reinterpret_cast<IdleChunk*>(chunk)->idle_since = kPurged;
+        }
+    }
+    return true;
+}
+
+size_t MmapArena::Populate() {
+    size_t populated = 0;
+    for (int fl = 0; fl < kFlCount; ++fl) {
+        if (!(fl_bitmap_ & (1u << fl))) {
+            continue;
+        }
+        for (int sl = 0; sl < kSlCount; ++sl) {
+            for (Chunk* chunk = blocks_[fl][sl]; chunk; chunk = chunk->next_free) {
+                size_t size = ChunkSize(chunk);
+                if (size < min_purge_chunk_) {
+                    continue;
+                }
+                // Iste granice kao u Purge; stranice ostaju dok ih Purge ne vrati.
+                IdleChunk* idle = reinterpret_cast<IdleChunk*>(chunk);
+                uintptr_t start = RoundUp(reinterpret_cast<uintptr_t>(idle + 1), purge_page_);
+                uintptr_t end = (reinterpret_cast<uintptr_t>(chunk) + size) & ~(static_cast<uintptr_t>(purge_page_) - 1);
+                if (end > start) {
+                    PopulatePages(reinterpret_cast<void*>(start), end - start);
+                    populated += end - start;
+                }
+                idle->idle_since = clock_;
+            }
+        }
+    }
+    return populated;
+}
+
+void MmapArena::ReleaseAll() {
+    DropCache();
+    while (segments_) {
+        Segment* next = segments_->next;
+        page_map_->Clear(segments_, segments_->size);
+        UnmapAligned(segments_, segments_->size);
+        segments_ = next;
+    }
+    mapped_bytes_ = 0;
+}
+
+size_t MmapArena::ChunkSizeFor(size_t size) {
+    size_t chunk_size = RoundUp(size + kHeaderSize, kAlignment);
+    return chunk_size < kMinChunkSize ? kMinChunkSize : chunk_size;
+}
+
+void* MmapArena::Allocate(size_t size) {
+    if (size > SIZE_MAX - kSegmentSize) {
+        return nullptr;
+    }
+    size_t chunk_size = ChunkSizeFor(size);
+    if (chunk_size >= large_chunk_) {
+        return AllocateDedicated(chunk_size, kAlignment);
+    }
+
+    Chunk* chunk = FindFree(chunk_size);
+    if (!chunk) {
+        // Nema dovoljno velikog slobodnog bloka - heap raste za jos jedan segment.
+        size_t segment_size = kSegmentSize;
+        if (!FitsBudget(segment_size)) {
+            segment_size = maximum_bytes_ - mapped_bytes_;
+            if (segment_size < chunk_size + kSegmentOverhead) {
+                return nullptr;
+            }
+        }
+        chunk = AddSegment(segment_size);
+        if (!chunk) {
+            return nullptr;
+        }
+    } else {
+        RemoveFree(chunk);
+    }
+
+    // Odseci visak ako je dovoljno velik da bude zaseban slobodan blok.
+    size_t available = ChunkSize(chunk);
+    if (available - chunk_size >= kMinChunkSize) {
+        Chunk* remainder = reinterpret_cast<Chunk*>(reinterpret_cast<char*>(chunk) + chunk_size);
+        remainder->size = (available - chunk_size) | kPrevInUse;
+        NextChunk(remainder)->prev_size = available - chunk_size;
+        InsertFree(remainder);
+        chunk->size = chunk_size | (chunk->size & kPrevInUse) | kInUse;
+    } else {
+        chunk->size |= kInUse;
+        NextChunk(chunk)->size |= kPrevInUse;
+    }
+    return PayloadOf(chunk);
+}
+
+void* MmapArena::AllocateAligned(size_t size, size_t alignment) {
+    if (alignment <= kAlignment) {
+        return Allocate(size);
+    }
+    if (alignment > kSegmentSize || size > SIZE_MAX - 2 * kSegmentSize) {
+        return nullptr;
+    }
+    size_t chunk_size = ChunkSizeFor(size);
+    // Blok sa rezervom za poravnanje ne sme i sam da postane veliki.
+    if (chunk_size + alignment + kMinChunkSize >= large_chunk_) {
+        return AllocateDedicated(chunk_size, alignment);
+    }
+
+    // Uzmi blok sa dovoljno rezerve, pa odseci i oslobodi deo ispred
+    // poravnate adrese i visak iza trazene velicine.
+    void* raw = Allocate(chunk_size - kHeaderSize + alignment + kMinChunkSize);
+    if (!raw) {
+        return nullptr;
+    }
+    uintptr_t address = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = RoundUp(address, alignment);
+    if (aligned != address && aligned - address < kMinChunkSize) {
+        aligned += alignment;
+    }
+
+    Chunk* chunk = ChunkFromPayload(raw);
+    size_t total = ChunkSize(chunk);
+    if (aligned != address) {
+        size_t lead = aligned - address;
+        Chunk* body = ChunkFromPayload(reinterpret_cast<void*>(aligned));
+        body->size = (total - lead) | kPrevInUse | kInUse;
+        chunk->size = lead | (chunk->size & kPrevInUse) | kInUse;
+        Free(PayloadOf(chunk));
+        chunk = body;
+        total -= lead;
+    }
+    if (total - chunk_size >= kMinChunkSize) {
+        Chunk* tail = reinterpret_cast<Chunk*>(reinterpret_cast<char*>(chunk) + chunk_size);
+        tail->size = (total - chunk_size) | kPrevInUse | kInUse;
+        chunk->size = chunk_size | (chunk->size & kPrevInUse) | kInUse;
+        Free(PayloadOf(tail));
+    }
+    return PayloadOf(chunk);
+}
+
+void* MmapArena::AllocateZeroed(size_t size) {
+    if (size > SIZE_MAX - kSegmentSize) {
+        return nullptr;
+    }
+    size_t chunk_size = ChunkSizeFor(size);
+    if (chunk_size >= large_chunk_) {
+        return AllocateDedicated(chunk_size, kAlignment, true);
+    }
+    void* ptr = Allocate(size);
+    if (ptr) {
+        std::memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+void* MmapArena::Reallocate(void* ptr, size_t size) {
+    if (size > SIZE_MAX - 2 * kSegmentSize) {
+        return nullptr;
+    }
+    size_t chunk_size = ChunkSizeFor(size);
+    Chunk* chunk = ChunkFromPayload(ptr);
+    size_t current = ChunkSize(chunk);
+    if (IsDedicated(chunk)) {
+        // Zaseban segment ostaje zaseban; manji blok se premesta u arenu.
+        return chunk_size >= large_chunk_ ? RemapDedicated(chunk, chunk_size) : nullptr;
+    }
+    if (chunk_size >= large_chunk_) {
+        return nullptr;
+    }
+
+    if (chunk_size > current) {
+        Chunk* next = NextChunk(chunk);
+        if ((next->size & kInUse) || current + ChunkSize(next) < chunk_size) {
+            return nullptr;
+        }
+        RemoveFree(next);
+        current += ChunkSize(next);
+        chunk->size = current | (chunk->size & kFlagMask);
+        NextChunk(chunk)->size |= kPrevInUse;
+    }
+
+    // Visak (posle spajanja ili pri smanjenju) vraca se kao slobodan blok.
+    if (current - chunk_size >= kMinChunkSize) {
+        Chunk* tail = reinterpret_cast<Chunk*>(reinterpret_cast<char*>(chunk) + chunk_size);
+        tail->size = (current - chunk_size) | kPrevInUse | kInUse;
+        chunk->size = chunk_size | (chunk->size & kPrevInUse) | kInUse;
+        Free(PayloadOf(tail));
+    }
+    return ptr;
+}
+
+void MmapArena::Free(void* ptr) {
+    Chunk* chunk = ChunkFromPayload(ptr);
+    size_t size = ChunkSize(chunk);
+    if (IsDedicated(chunk)) {
+        // Veliki blokovi imaju sopstveni segment: ide u kes ili odmah OS-u.
+        Segment* segment = SegmentOf(chunk);
+        if (!CacheSegment(segment)) {
+            ReleaseSegment(segment);
+        }
+        return;
+    }
+
+    // Spoji sa sledecim slobodnim blokom (fence na kraju segmenta je uvek zauzet).
+    Chunk* next = NextChunk(chunk);
+    if (!(next->size & kInUse)) {
+        RemoveFree(next);
+        size += ChunkSize(next);
+    }
+
+    // Spoji sa prethodnim slobodnim blokom.
+    if (!(chunk->size & kPrevInUse)) {
+        Chunk* prev = reinterpret_cast<Chunk*>(reinterpret_cast<char*>(chunk) - chunk->prev_size);
+        RemoveFree(prev);
+        size += ChunkSize(prev);
+        chunk = prev;
+    }
+
+    chunk->size = size | kPrevInUse;
+    next = NextChunk(chunk);
+    next->prev_size = size;
+    next->size &= ~kPrevInUse;
+    InsertFree(chunk);
+}
+
+size_t MmapArena::UsableSize(const void* ptr) {
+    return ChunkSize(ChunkFromPayload(ptr)) - kHeaderSize;
+}
+
+size_t MmapArena::OwnerHeap(const void* ptr) {
+    // ptr - 1 je uvek u prvih kSegmentSize bajtova svog segmenta, i za blok
+    // poravnat na kraj prvog dela zasebnog segmenta.
+    uintptr_t address = reinterpret_cast<uintptr_t>(ptr) - 1;
+    const Segment* segment = reinterpret_cast<const Segment*>(address & ~(static_cast<uintptr_t>(kSegmentSize) - 1));
+    return segment->heap_index;
+}
+
+size_t MmapArena::Purge(uint64_t now_ms, uint64_t decay_ms) {
+    clock_ = now_ms;
+    size_t released = 0;
+    Segment* segment = large_cache_;
+    while (segment) {
+        Segment* next = segment->next;
+        if (now_ms - reinterpret_cast<CachedSegment*>(segment)->idle_since >= decay_ms) {
+            released += segment->size;
+            UncacheSegment(segment);
+            UnmapSegment(segment);
+        }
+        segment = next;
+    }
+    for (int fl = 0; fl < kFlCount; ++fl) {
+        if (!(fl_bitmap_ & (1u << fl))) {
+            continue;
+        }
+        for (int sl = 0; sl < kSlCount; ++sl) {
+            for (Chunk* chunk = blocks_[fl][sl]; chunk; chunk = chunk->next_free) {
+                size_t size = ChunkSize(chunk);
+                if (size < min_purge_chunk_) {
+                    continue;
+                }
+                IdleChunk* idle = reinterpret_cast<IdleChunk*>(chunk);
+                if (idle->idle_since == kPurged || now_ms - idle->idle_since < decay_ms) {
+                    continue;
+                }
+                // Zaglavlje i veze ostaju; OS dobija samo cele stranice iza njih.
+                uintptr_t start = RoundUp(reinterpret_cast<uintptr_t>(idle + 1), purge_page_);
+                uintptr_t end = (reinterpret_cast<uintptr_t>(chunk) + size) & ~(static_cast<uintptr_t>(purge_page_) - 1);
+                if (end > start && madvise(reinterpret_cast<void*>(start), end - start, MADV_DONTNEED) == 0) {
+                    released += end - start;
+                }
+                idle->idle_since = kPurged;
+            }
+        }
+    }
+    return released;
+}
+
+void MmapArena::Mapping(size_t size, int& fl, int& sl) {
+    if (size < kSmallBlockSize) {
+        fl = 0;
+        sl = static_cast<int>(size / kAlignment);
+    } else {
+        int log2 = FloorLog2(size);
+        sl = static_cast<int>(size >> (log2 - kSlShift)) ^ kSlCount;
+        fl = log2 - kFlShift + 1;
+    }
+}
+
+void MmapArena::InsertFree(Chunk* chunk) {
+    int fl = 0;
+    int sl = 0;
+    Mapping(ChunkSize(chunk), fl, sl);
+    Chunk* head = blocks_[fl][sl];
+    chunk->next_free = head;
+    chunk->prev_free = nullptr;
+    if (head) {
+        head->prev_free = chunk;
+    }
+    blocks_[fl][sl] = chunk;
+    fl_bitmap_ |= 1u << fl;
+    sl_bitmap_[fl] |= 1u << sl;
+    if (ChunkSize(chunk) >= min_purge_chunk_) {
+        reinterpret_cast<IdleChunk*>(chunk)->idle_since = clock_;
+    }
+}
+
+void MmapArena::RemoveFree(Chunk* chunk) {
+    int fl = 0;
+    int sl = 0;
+    Mapping(ChunkSize(chunk), fl, sl);
+    if (chunk->next_free) {
+        chunk->next_free->prev_free = chunk->prev_free;
+    }
+    if (chunk->prev_free) {
+        chunk->prev_free->next_free = chunk->next_free;
+    } else {
+        blocks_[fl][sl] = chunk->next_free;
+        if (!blocks_[fl][sl]) {
+            sl_bitmap_[fl] &= ~(1u << sl);
+            if (!sl_bitmap_[fl]) {
+                fl_bitmap_ &= ~(1u << fl);
+            }
+        }
+    }
+}
+
+MmapArena::Chunk* MmapArena::FindFree(size_t chunk_size) {
+    // Zaokruzi na sledecu pod-listu kako bi svaki blok iz nje bio dovoljno velik.
+    size_t search = chunk_size;
+    if (search >= kSmallBlockSize) {
+        search += (static_cast<size_t>(1) << (FloorLog2(search) - kSlShift)) - 1;
+    }
+    int fl = 0;
+    int sl = 0;
+    Mapping(search, fl, sl);
+    if (fl >= kFlCount) {
+        return nullptr;
+    }
+
+    uint32_t sl_map = sl_bitmap_[fl] & (~0u << sl);
+    if (!sl_map) {
+        uint32_t fl_map = (fl + 1 < 32) ? (fl_bitmap_ & (~0u << (fl + 1))) : 0;
+        if (!fl_map) {
+            return nullptr;
+        }
+        fl = __builtin_ctz(fl_map);
+        sl_map = sl_bitmap_[fl];
+    }
+    sl = __builtin_ctz(sl_map);
+    return blocks_[fl][sl];
+}
+
+MmapArena::Segment* MmapArena::MapSegment(size_t segment_size, uint32_t page_entry) {
+    if (huge_pages_) {
+        segment_size = RoundUp(segment_size, kHugePageSize);
+    }
+    if (!FitsBudget(segment_size)) {
+        return nullptr;
+    }
+    void* memory = MapAligned(segment_size, kSegmentSize, huge_pages_);
+    if (!memory) {
+        return nullptr;
+    }
+    // Stranice segmenta se registruju pre nego sto ijedan blok izadje napolje.
+    if (!page_map_->Set(memory, segment_size, page_entry)) {
+        page_map_->Clear(memory, segment_size);
+        UnmapAligned(memory, segment_size);
+        return nullptr;
+    }
+
+    Segment* segment = static_cast<Segment*>(memory);
+    segment->size = segment_size;
+    segment->heap_index = heap_index_;
+    LinkSegment(segment);
+    mapped_bytes_ += segment_size;
+    return segment;
+}
+
+void MmapArena::LinkSegment(Segment* segment) {
+    segment->prev = nullptr;
+    segment->next = segments_;
+    if (segments_) {
+        segments_->prev = segment;
+    }
+    segments_ = segment;
+}
+
+void MmapArena::UnlinkSegment(Segment* segment) {
+    if (segment->prev) {
+        segment->prev->next = segment->next;
+    } else {
+        segments_ = segment->next;
+    }
+    if (segment->next) {
+        segment->next->prev = segment->prev;
+    }
+}
+
+bool MmapArena::FitsBudget(size_t extra) {
+    if (maximum_bytes_ == 0 || mapped_bytes_ + extra <= maximum_bytes_) {
+        return true;
+    }
+    DropCache();
+    return mapped_bytes_ + extra <= maximum_bytes_;
+}
+
+MmapArena::Chunk* MmapArena::AddSegment(size_t segment_size) {
+    Segment* segment = MapSegment(segment_size, PageMap::Encode(heap_index_, 0));
+    if (!segment) {
+        return nullptr;
+    }
+
+    // Jedan slobodan blok preko celog segmenta, a na kraju zauzeti "fence".
+    size_t chunk_size = segment->size - kSegmentOverhead;
+    Chunk* chunk = reinterpret_cast<Chunk*>(reinterpret_cast<char*>(segment) + sizeof(Segment));
+    chunk->prev_size = 0;
+    chunk->size = chunk_size | kPrevInUse;
+    Chunk* fence = NextChunk(chunk);
+    fence->prev_size = chunk_size;
+    fence->size = kInUse;
+    return chunk;
+}
+
+void* MmapArena::MapRawSegment(uint32_t page_entry) {
+    return MapSegment(kSegmentSize, page_entry);
+}
+
+void MmapArena::ReleaseSegment(Segment* segment) {
+    UnlinkSegment(segment);
+    UnmapSegment(segment);
+}
+
+void MmapArena::UnmapSegment(Segment* segment) {
+    mapped_bytes_ -= segment->size;
+    page_map_->Clear(segment, segment->size);
+    UnmapAligned(segment, segment->size);
+}
+
+MmapArena::Segment* MmapArena::TakeCachedSegment(size_t segment_size) {
+    Segment* best = nullptr;
+    for (Segment* segment = large_cache_; segment; segment = segment->next) {
+        if (segment->size >= segment_size && segment->size - segment_size <= segment_size / 4 &&
+            (!best || segment->size < best->size)) {
+            best = segment;
+        }
+    }
+    if (best) {
+        UncacheSegment(best);
+        LinkSegment(best);
+    }
+    return best;
+}
+
+bool MmapArena::CacheSegment(Segment* segment) {
+    if (segment->size > large_cache_bytes_) {
+        return false;
+    }
+    UnlinkSegment(segment);
+    // Mesto se pravi izbacivanjem najstarijih (sa kraja liste).
+    while (cached_count_ == kLargeCacheSlots || cached_bytes_ + segment->size > large_cache_bytes_) {
+        Segment* oldest = large_cache_;
+        while (oldest->next) {
+            oldest = oldest->next;
+        }
+        UncacheSegment(oldest);
+        UnmapSegment(oldest);
+    }
+    // Stranice ostaju u mapi stranica, pa ponovna upotreba ne menja mapu.
+    segment->prev = nullptr;
+    segment->next = large_cache_;
+    if (large_cache_) {
+        large_cache_->prev = segment;
+    }
+    large_cache_ = segment;
+    reinterpret_cast<CachedSegment*>(segment)->idle_since = clock_;
+    cached_bytes_ += segment->size;
+    ++cached_count_;
+    return true;
+}
+
+void MmapArena::UncacheSegment(Segment* segment) {
+    if (segment->prev) {
+        segment->prev->next = segment->next;
+    } else {
+        large_cache_ = segment->next;
+    }
+    if (segment->next) {
+        segment->next->prev = segment->prev;
+    }
+    cached_bytes_ -= segment->size;
+    --cached_count_;
+}
+
+void MmapArena::DropCache() {
+    while (large_cache_) {
+        Segment* segment = large_cache_;
+        UncacheSegment(segment);
+        UnmapSegment(segment);
+    }
+}
+
+void* MmapArena::RemapDedicated(Chunk* chunk, size_t chunk_size) {
+    // Pomeraj bloka u segmentu se cuva, pa i poravnanje (najvise kSegmentSize).
+    Segment* segment = SegmentOf(chunk);
+    size_t offset = reinterpret_cast<char*>(chunk) - reinterpret_cast<char*>(segment);
+    size_t old_size = segment->size;
+    size_t new_size = RoundUp(offset + chunk_size + kHeaderSize, huge_pages_ ? kHugePageSize : kPageSize);
+    if (new_size > old_size && !FitsBudget(new_size - old_size)) {
+        return nullptr;
+    }
+
+    uint32_t entry = PageMap::Encode(heap_index_, 0);
+    Segment* moved = segment;
+    // Unosi mape se brisu pre nego sto OS dobije opseg nazad: drugi heap ga
+    // odmah moze ponovo mapirati i registrovati.
+    if (new_size < old_size) {
+        char* tail = reinterpret_cast<char*>(segment) + new_size;
+        page_map_->Clear(tail, old_size - new_size);
+        if (mremap(segment, old_size, new_size, 0) == MAP_FAILED) {
+            page_map_->Set(tail, old_size - new_size, entry);
+            return nullptr;
+        }
+    } else if (new_size > old_size) {
+        void* grown = mremap(segment, old_size, new_size, 0);
+        if (grown != MAP_FAILED) {
+            if (!page_map_->Set(reinterpret_cast<char*>(segment) + old_size, new_size - old_size, entry)) {
+                page_map_->Clear(reinterpret_cast<char*>(segment) + old_size, new_size - old_size);
+                mremap(segment, new_size, old_size, 0);
+                return nullptr;
+            }
+        } else {
+            // Mesto iza segmenta je zauzeto: rezervisi novi poravnat region i
+            // premesti stranice u njega (bez kopiranja sadrzaja).
+            void* target = MapAligned(new_size, kSegmentSize, huge_pages_);
+            if (!target) {
+                return nullptr;
+            }
+            if (!page_map_->Set(target, new_size, entry)) {
+                page_map_->Clear(target, new_size);
+                UnmapAligned(target, new_size);
+                return nullptr;
+            }
+            page_map_->Clear(segment, old_size);
+            grown = mremap(segment, old_size, new_size, MREMAP_MAYMOVE | MREMAP_FIXED, target);
+            if (grown == MAP_FAILED) {
+                page_map_->Set(segment, old_size, entry);
+                page_map_->Clear(target, new_size);
+                UnmapAligned(target, new_size);
+                return nullptr;
+            }
+            ReleaseHint(segment, old_size);
+            moved = static_cast<Segment*>(grown);
+            if (moved->prev) {
+                moved->prev->next = moved;
+            } else {
+                segments_ = moved;
+            }
+            if (moved->next) {
+                moved->next->prev = moved;
+            }
+        }
+    } else {
+        return PayloadOf(chunk);
+    }
+
+    mapped_bytes_ = mapped_bytes_ - old_size + new_size;
+    moved->size = new_size;
+    chunk = reinterpret_cast<Chunk*>(reinterpret_cast<char*>(moved) + offset);
+    size_t size = new_size - offset - kHeaderSize;
+    chunk->size = size | kDedicated | kPrevInUse | kInUse;
+    Chunk* fence = NextChunk(chunk);
+    fence->prev_size = size;
+    fence->size = kInUse | kPrevInUse;
+    return PayloadOf(chunk);
+}
+
+void* MmapArena::AllocateDedicated(size_t chunk_size, size_t alignment, bool zeroed) {
+    // Blok dobija ceo segment; kod poravnatog bloka prostor izmedju zaglavlja
+    // segmenta i bloka ostaje neiskoriscen.
+    size_t extra = alignment > kAlignment ? alignment : 0;
+    size_t segment_size = RoundUp(chunk_size + kSegmentOverhead + extra, huge_pages_ ? kHugePageSize : kPageSize);
+    Segment* segment = TakeCachedSegment(segment_size);
+    bool cached = segment != nullptr;
+    if (!segment) {
+        segment = MapSegment(segment_size, PageMap::Encode(heap_index_, 0));
+        if (!segment) {
+            return nullptr;
+        }
+    }
+    uintptr_t start = reinterpret_cast<uintptr_t>(segment);
+    uintptr_t payload = RoundUp(start + kSegmentOverhead, alignment);
+    Chunk* chunk = ChunkFromPayload(reinterpret_cast<void*>(payload));
+    size_t size = start + segment->size - kHeaderSize - reinterpret_cast<uintptr_t>(chunk);
+    chunk->prev_size = 0;
+    chunk->size = size | kDedicated | kPrevInUse | kInUse;
+    Chunk* fence = NextChunk(chunk);
+    fence->prev_size = size;
+    fence->size = kInUse | kPrevInUse;
+    if (zeroed && cached) {
+        std::memset(PayloadOf(chunk), 0, chunk_size - kHeaderSize);
+    }
+    return PayloadOf(chunk);
+}
+
+#endif
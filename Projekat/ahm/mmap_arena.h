@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "page_map.h"
+
+// Heap nad mmap regionima (ne-Windows platforme).
+// Memorija se uzima od OS-a u segmentima poravnatim na kSegmentSize, a unutar
+// segmenta blokovi se dele i spajaju pomocu granicnih oznaka (boundary tags).
+// Slobodni blokovi se cuvaju u TLSF listama (dvonivojske segregisane liste sa
+// bitmapama), pa su i alokacija i oslobadjanje O(1).
+// Klasa nije thread-safe; sinhronizaciju obezbedjuje AdvancedHeapManager.
+class MmapArena {
+public:
+    static const size_t kSegmentSize = 4 * 1024 * 1024;
+    // Velicina zaglavlja segmenta, ujedno pocetak slobodnog dela sirovog segmenta.
+    static const size_t kRawSegmentOffset = 32;
+
+    // Velicina velike stranice (huge page) na x86-64 i ARM64.
+    static const size_t kHugePageSize = 2 * 1024 * 1024;
+
+    // Najveci broj slobodnih segmenata velikih blokova u kesu arene.
+    static const size_t kLargeCacheSlots = 16;
+
+    // initial_size_bytes se mapira odmah, maximum_size_bytes (ako nije 0)
+    // ogranicava ukupnu mapiranu memoriju - isto kao HeapCreate na Windows-u.
+    // Svaki segment se registruje u page_map kao vlasnistvo heap-a heap_index.
+    // Sa huge_pages segmenti se zaokruzuju na kHugePageSize i mapiraju sa
+    // MAP_HUGETLB, a ako sistem nema rezervisane velike stranice, obicnim
+    // mmap-om uz madvise(MADV_HUGEPAGE) (transparentne velike stranice).
+    // Blokovi od large_threshold bajtova navise (0: samo oni koji ne staju u
+    // segment) dobijaju sopstveni segment, koji se pri oslobadjanju vraca OS-u;
+    // do large_cache_bytes takvih segmenata (najvise kLargeCacheSlots) se
+    // umesto toga cuva za sledece velike blokove, dok ih Purge ne vrati.
+    MmapArena(size_t heap_index, PageMap* page_map, size_t initial_size_bytes, size_t maximum_size_bytes,
+        bool huge_pages = false, size_t large_threshold = 0, size_t large_cache_bytes = 0);
+    ~MmapArena();
+
+    MmapArena(const MmapArena&) = delete;
+    MmapArena& operator=(const MmapArena&) = delete;
+
+    void* Allocate(size_t size);
+    // alignment je stepen dvojke, najvise kSegmentSize (inace nullptr).
+    void* AllocateAligned(size_t size, size_t alignment);
+    // Kao Allocate, ali je blok popunjen nulama; sveze mapirani zasebni
+    // segmenti su vec nule, pa se za njih memset preskace.
+    void* AllocateZeroed(size_t size);
+    // Menja velicinu bloka bez kopiranja: spajanjem sa slobodnim sledecim
+    // blokom ili, za blokove u zasebnom segmentu, pomocu mremap. Vraca novu
+    // adresu ili nullptr ako to nije moguce (blok ostaje nepromenjen).
+    void* Reallocate(void* ptr, size_t size);
+    void Free(void* ptr);
+
+    // Broj bajtova koji su stvarno upotrebljivi u bloku (>= trazene velicine).
+    static size_t UsableSize(const void* ptr);
+    // Heap vlasnik bloka iz zaglavlja segmenta (ptr mora biti iz neke arene,
+    // blok ili slab objekat); bez citanja mape stranica.
+    static size_t OwnerHeap(const void* ptr);
+
+    // Ukljucuje i segmente u kesu velikih blokova (CachedBytes).
+    size_t MappedBytes() const { return mapped_bytes_; }
+    size_t CachedBytes() const { return cached_bytes_; }
+
+    // Vraca OS-u memoriju slobodnih blokova koji su neaktivni bar decay_ms
+    // (po casovniku now_ms koji zadaje pozivalac, a koji se pamti pri svakom
+    // oslobadjanju): segment iz kesa velikih blokova se odmapira, a unutrasnje
+    // stranice ostalih blokova se prazne sa madvise(MADV_DONTNEED).
+    // Vraca broj vracenih bajtova.
+    size_t Purge(uint64_t now_ms, uint64_t decay_ms);
+
+    // Mapira nove segmente dok arena ne drzi bar bytes bajtova (kao
+    // initial_size_bytes); stranice se ne dodiruju. false ako mmap ili
+    // maximum_size_bytes to ne dozvoljavaju (mapirano do tada ostaje).
+    bool Reserve(size_t bytes);
+    // Ucitava u memoriju stranice slobodnih blokova (MADV_POPULATE_WRITE, a
+    // na starijim kernelima dodirom svake stranice), da prve alokacije ne bi
+    // cekale na page fault. Vraca broj ucitanih bajtova.
+    size_t Populate();
+    // Ucitava u memoriju stranice opsega [start, start + size) bez menjanja sadrzaja.
+    static void PopulatePages(void* start, size_t size);
+    // Drzi zajednicku listu predloga adresa tokom fork-a (BasicHeapManager::LockForFork).
+    static void LockForFork();
+    static void UnlockAfterFork();
+
+    // Sirov segment od kSegmentSize bajtova (npr. za slab-ove): ulazi u budzet
+    // heap-a i unistava se sa arenom, ali se ne deli na blokove. Slobodan deo
+    // pocinje kRawSegmentOffset bajtova od vracene (poravnate) adrese, a sve
+    // stranice se registruju sa page_entry.
+    void* MapRawSegment(uint32_t page_entry);
+
+private:
+    // Zaglavlje bloka. prev_size vazi samo kada je prethodni blok slobodan;
+    // next_free/prev_free postoje samo u slobodnim blokovima (u payload-u).
+    struct Chunk {
+        size_t prev_size;
+        size_t size;
+        Chunk* next_free;
+        Chunk* prev_free;
+    };
+
+    // Slobodan blok dovoljno velik da mu se stranice vrate OS-u: posle veza u
+    // listi cuva vreme oslobadjanja (kPurged kada su stranice vec vracene).
+    struct IdleChunk {
+        Chunk chunk;
+        uint64_t idle_since;
+    };
+    static const uint64_t kPurged = ~static_cast<uint64_t>(0);
+
+    // Zaglavlje segmenta, na pocetku svakog mmap regiona.
+    struct Segment {
+        Segment* next;
+        Segment* prev;
+        size_t size;
+        size_t heap_index;
+    };
+
+    // Segment u kesu velikih blokova: iza zaglavlja (umesto bloka) cuva vreme
+    // oslobadjanja. Veze zaglavlja ga drze u listi kesa, ne u segments_.
+    struct CachedSegment {
+        Segment segment;
+        uint64_t idle_since;
+    };
+
+    static const size_t kAlignment = 16;
+    static const size_t kHeaderSize = 2 * sizeof(size_t);
+    static const size_t kMinChunkSize = sizeof(Chunk);
+    static const size_t kSegmentOverhead = sizeof(Segment) + kHeaderSize;
+    static const size_t kMaxSegmentChunk = kSegmentSize - kSegmentOverhead;
+
+    // Segmenti se zaokruzuju na stranice mape kako dva segmenta ne bi delila unos.
+    static const size_t kPageSize = PageMap::kPageSize;
+
+    static const size_t kInUse = 1;
+    static const size_t kPrevInUse = 2;
+    // Blok ima sopstveni segment (veliki blok); ne deli se i ne spaja.
+    static const size_t kDedicated = 4;
+    static const size_t kFlagMask = kAlignment - 1;
+
+    // TLSF parametri: 16 pod-lista po stepenu dvojke, blokovi manji od
+    // kSmallBlockSize idu u linearne liste na prvom nivou.
+    static const int kSlShift = 4;
+    static const int kSlCount = 1 << kSlShift;
+    static const size_t kSmallBlockSize = kSlCount * kAlignment;
+    static const int kFlShift = kSlShift + 4;  // log2(kSmallBlockSize)
+    static const int kFlCount = 16;
+
+    static size_t ChunkSize(const Chunk* chunk) { return chunk->size & ~kFlagMask; }
+    static Chunk* NextChunk(Chunk* chunk) {
+        return reinterpret_cast<Chunk*>(reinterpret_cast<char*>(chunk) + ChunkSize(chunk));
+    }
+    static bool IsDedicated(const Chunk* chunk) { return (chunk->size & kDedicated) != 0; }
+    // Zaglavlje bloka je uvek u prvih kSegmentSize bajtova svog segmenta.
+    static Segment* SegmentOf(const Chunk* chunk) {
+        return reinterpret_cast<Segment*>(reinterpret_cast<uintptr_t>(chunk) & ~(static_cast<uintptr_t>(kSegmentSize) - 1));
+    }
+    static Chunk* ChunkFromPayload(const void* ptr) {
+        return reinterpret_cast<Chunk*>(const_cast<char*>(static_cast<const char*>(ptr)) - kHeaderSize);
+    }
+    static void* PayloadOf(Chunk* chunk) {
+        return reinterpret_cast<char*>(chunk) + kHeaderSize;
+    }
+
+    static void Mapping(size_t size, int& fl, int& sl);
+
+    void InsertFree(Chunk* chunk);
+    void RemoveFree(Chunk* chunk);
+    Chunk* FindFree(size_t chunk_size);
+
+    // Mapira novi segment (poravnat na kSegmentSize) i vraca njegov prvi blok.
+    Chunk* AddSegment(size_t segment_size);
+    Segment* MapSegment(size_t segment_size, uint32_t page_entry);
+    void LinkSegment(Segment* segment);
+    void UnlinkSegment(Segment* segment);
+    // Izbacuje segment iz liste i vraca ga OS-u.
+    void ReleaseSegment(Segment* segment);
+    void UnmapSegment(Segment* segment);
+    void ReleaseAll();
+    // Da li mapiranje jos extra bajtova staje u maximum_bytes_; ako ne staje,
+    // prvo se prazni kes velikih blokova.
+    bool FitsBudget(size_t extra);
+
+    // zeroed: blok iz kesa se brise (sveze mapiran je vec nula).
+    void* AllocateDedicated(size_t chunk_size, size_t alignment, bool zeroed = false);
+    void* RemapDedicated(Chunk* chunk, size_t chunk_size);
+    // Kes velikih blokova: segment dobija najmanji kesirani segment od bar
+    // segment_size bajtova (uz najvise 25% viska), a oslobodjeni se stavlja
+    // na pocetak kesa, uz izbacivanje najstarijih preko ogranicenja.
+    Segment* TakeCachedSegment(size_t segment_size);
+    bool CacheSegment(Segment* segment);
+    void UncacheSegment(Segment* segment);
+    void DropCache();
+    static size_t ChunkSizeFor(size_t size);
+
+    Chunk* blocks_[kFlCount][kSlCount];
+    uint32_t fl_bitmap_;
+    uint32_t sl_bitmap_[kFlCount];
+
+    Segment* segments_;
+    // Najmanji blok (sa zaglavljem) koji dobija sopstveni segment.
+    size_t large_chunk_;
+    Segment* large_cache_;
+    size_t large_cache_bytes_;
+    size_t cached_bytes_;
+    size_t cached_count_;
+    size_t heap_index_;
+    PageMap* page_map_;
+    size_t mapped_bytes_;
+    size_t maximum_bytes_;
+    bool huge_pages_;
+    // Stranica za madvise (sistemska ili velika) i najmanji blok koji se prazni.
+    size_t purge_page_;
+    size_t min_purge_chunk_;
+    // Vreme poslednjeg Purge poziva; njime se oznacavaju novi slobodni blokovi.
+    uint64_t clock_;
+};
@@ -0,0 +1,111 @@
+#ifndef _WIN32
+
+#include "page_map.h"
+
+#include <new>
+
+#include <sys/mman.h>
+
+namespace {
+// Metapodaci mape se uzimaju direktno od OS-a (nula-stranice, lenjo se popunjavaju).
+void* MapZeroed(size_t size) {
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return memory == MAP_FAILED ? nullptr : memory;
+}
+}
+
+PageMap::PageMap() {
+    root_ = static_cast<std::atomic<Leaf*>*>(MapZeroed(kRootSize * sizeof(std::atomic<Leaf*>)));
+    live_ = static_cast<uint32_t*>(MapZeroed(kRootSize * sizeof(uint32_t)));
+    if (!root_ || !live_) {
+        if (root_) {
+            munmap(root_, kRootSize * sizeof(std::atomic<Leaf*>));
+        }
+        throw std::bad_alloc();
+    }
+}
+
+PageMap::~PageMap() {
+    for (size_t i = 0; i < kRootSize; ++i) {
+        Leaf* leaf = root_[i].load(std::memory_order_relaxed);
+        if (leaf) {
+            munmap(leaf, sizeof(Leaf));
+        }
+    }
+    munmap(root_, kRootSize * sizeof(std::atomic<Leaf*>));
+    munmap(live_, kRootSize * sizeof(uint32_t));
+}
+
+bool PageMap::Set(const void* start, size_t size, uint32_t entry) {
+    uintptr_t first = reinterpret_cast<uintptr_t>(start) >> kPageShift;
+    uintptr_t last = (reinterpret_cast<uintptr_t>(start) + size - 1) >> kPageShift;
+    if (last >= (static_cast<uintptr_t>(1) << (kRootBits + kLeafBits))) {
+        return false;
+    }
+    // Registrovane stranice pripadaju pozivaocu i niko drugi ih ne brise, pa
+    // se njihov unos (npr. klasa slab-a) menja bez zakljucavanja.
+    uintptr_t page = first;
+    for (; page <= last; ++page) {
+        Leaf* leaf = root_[page >> kLeafBits].load(std::memory_order_acquire);
+        if (!leaf) {
+            break;
+        }
+        std::atomic<uint32_t>& slot = leaf->entries[page & (kLeafSize - 1)];
+        if (slot.load(std::memory_order_relaxed) == 0) {
+            break;
+        }
+        slot.store(entry, std::memory_order_relaxed);
+    }
+    if (page > last) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (; page <= last; ++page) {
+        Leaf* leaf = EnsureLeaf(page >> kLeafBits);
+        if (!leaf) {
+            return false;
+        }
+        if (leaf->entries[page & (kLeafSize - 1)].exchange(entry, std::memory_order_relaxed) == 0) {
+            ++live_[page >> kLeafBits];
+        }
+    }
+    return true;
+}
+
+void PageMap::Clear(const void* start, size_t size) {
+    uintptr_t first = reinterpret_cast<uintptr_t>(start) >> kPageShift;
+    uintptr_t last = (reinterpret_cast<uintptr_t>(start) + size - 1) >> kPageShift;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uintptr_t page = first; page <= last; ++page) {
+        size_t root_index = page >> kLeafBits;
+        Leaf* leaf = root_[root_index].load(std::memory_order_relaxed);
+        if (!leaf || leaf->entries[page & (kLeafSize - 1)].exchange(0, std::memory_order_relaxed) == 0) {
+            continue;
+        }
+        // Regioni ne dobijaju uvek iste adrese, pa bi listovi bez zivih
+        // unosa inace zauvek drzali svoje (nulte) stranice.
+        if (--live_[root_index] == 0) {
+            madvise(leaf, sizeof(Leaf), MADV_DONTNEED);
+        }
+    }
+}
+
+PageMap::Leaf* PageMap::EnsureLeaf(size_t root_index) {
+    Leaf* leaf = root_[root_index].load(std::memory_order_acquire);
+    if (leaf) {
+        return leaf;
+    }
+    // Vise heap-ova moze istovremeno da registruje segmente u istom listu.
+    Leaf* created = static_cast<Leaf*>(MapZeroed(sizeof(Leaf)));
+    if (!created) {
+        return nullptr;
+    }
+    if (!root_[root_index].compare_exchange_strong(leaf, created, std::memory_order_acq_rel)) {
+        munmap(created, sizeof(Leaf));
+        return leaf;
+    }
+    return created;
+}
+
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// Radix mapa stranica (po uzoru na tcmalloc) za ne-Windows platforme.
+// Svaka stranica od 64 KiB koju AHM drzi ima jedan 32-bitni unos iz koga se
+// direktno citaju heap vlasnik i klasa velicine. Mapa ima dva nivoa: koren je
+// niz pokazivaca na listove, a list pokriva 4 GiB adresnog prostora.
+// Listovi se mapiraju pri registraciji segmenta, pa Get nikada ne alocira,
+// a adrese koje AHM ne poznaje vracaju 0. List bez ijednog registrovanog
+// unosa vraca stranice OS-u (ostaje mapiran, pa ga Get i dalje cita kao 0).
+class PageMap {
+public:
+    static const int kPageShift = 16;
+    static const size_t kPageSize = static_cast<size_t>(1) << kPageShift;
+
+    PageMap();
+    ~PageMap();
+
+    PageMap(const PageMap&) = delete;
+    PageMap& operator=(const PageMap&) = delete;
+
+    // Klasa za stranice koje AHM drzi ali u njima nema zivih blokova
+    // (metapodaci slab segmenta, prazni slab-ovi); Free ih ignorise.
+    static const size_t kUnusedClass = 0xFF;
+
+    // Unos: heap_index + 1 u nizih 16 bita, klasa velicine u sledecih 8
+    // (0 = blok iz opste arene, 1..kUnusedClass-1 = slab klasa).
+    static uint32_t Encode(size_t heap_index, size_t size_class) {
+        return static_cast<uint32_t>((heap_index + 1) | (size_class << 16));
+    }
+    static size_t HeapIndex(uint32_t entry) { return (entry & 0xFFFFu) - 1; }
+    static size_t SizeClass(uint32_t entry) { return (entry >> 16) & 0xFFu; }
+
+    // Registruje opseg [start, start + size); start i size su poravnati na kPageSize.
+    // Preoznacavanje vec registrovanih stranica ne zakljucava mapu.
+    bool Set(const void* start, size_t size, uint32_t entry);
+    void Clear(const void* start, size_t size);
+
+    // Drzi mutex mape tokom fork-a (BasicHeapManager::LockForFork).
+    void LockForFork() { mutex_.lock(); }
+    void UnlockAfterFork() { mutex_.unlock(); }
+
+    uint32_t Get(const void* ptr) const {
+        uintptr_t page = reinterpret_cast<uintptr_t>(ptr) >> kPageShift;
+        if (page >= (static_cast<uintptr_t>(1) << (kRootBits + kLeafBits))) {
+            return 0;
+        }
+        Leaf* leaf = root_[page >> kLeafBits].load(std::memory_order_acquire);
+        if (!leaf) {
+            return 0;
+        }
+        return leaf->entries[page & (kLeafSize - 1)].load(std::memory_order_relaxed);
+    }
+
+private:
+    // 47-bitni korisnicki adresni prostor: 15 bita korena + 16 bita lista.
+    static const int kRootBits = 15;
+    static const int kLeafBits = 47 - kPageShift - kRootBits;
+    static const size_t kRootSize = static_cast<size_t>(1) << kRootBits;
+    static const size_t kLeafSize = static_cast<size_t>(1) << kLeafBits;
+
+    struct Leaf {
+        std::atomic<uint32_t> entries[kLeafSize];
+    };
+
+    Leaf* EnsureLeaf(size_t root_index);
+
+    std::atomic<Leaf*>* root_;
+    // Broj registrovanih (ne-nultih) unosa po listu, pod mutex_-om.
+    uint32_t* live_;
+    // Prelazi unosa izmedju 0 i ne-nule (registracija i brisanje opsega).
+    std::mutex mutex_;
+};
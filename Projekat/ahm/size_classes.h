@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Klase velicina za male objekte, izracunate u vreme kompajliranja.
+// Do 256 bajtova klase rastu po 16 bajtova, a iznad toga ima po cetiri klase
+// na svaki stepen dvojke, sve do kMaxSmallSize. Klasa 0 je rezervisana za
+// blokove koji ne prolaze kroz slab-ove.
+namespace size_class_detail {
+constexpr size_t kAlignment = 16;
+constexpr size_t kMaxSmallSize = 16 * 1024;
+constexpr size_t kSlabSize = 64 * 1024;
+constexpr size_t kCount = 1 + 16 + 4 * 6;
+constexpr size_t kLookupLimit = 1024;
+
+struct Table {
+    size_t size[kCount];
+    uint32_t objects[kCount];
+    uint8_t lookup[kLookupLimit / kAlignment + 1];
+};
+
+constexpr Table MakeTable() {
+    Table table{};
+    size_t cls = 1;
+    for (size_t size = kAlignment; size <= 256; size += kAlignment) {
+        table.size[cls++] = size;
+    }
+    for (size_t base = 256; base < kMaxSmallSize; base *= 2) {
+        for (size_t sub = 1; sub <= 4; ++sub) {
+            table.size[cls++] = base + sub * (base / 4);
+        }
+    }
+    for (size_t i = 1; i < kCount; ++i) {
+        table.objects[i] = static_cast<uint32_t>(kSlabSize / table.size[i]);
+    }
+    // Brza tabela za male zahteve: (size + 15) / 16 -> klasa.
+    size_t current = 1;
+    for (size_t i = 0; i <= kLookupLimit / kAlignment; ++i) {
+        while (table.size[current] < i * kAlignment) {
+            ++current;
+        }
+        table.lookup[i] = static_cast<uint8_t>(current);
+    }
+    return table;
+}
+
+inline constexpr Table kTable = MakeTable();
+
+static_assert(kTable.size[kCount - 1] == kMaxSmallSize, "size class table must end at kMaxSmallSize");
+}
+
+class SizeClasses {
+public:
+    static constexpr size_t kMaxSmallSize = size_class_detail::kMaxSmallSize;
+    // Velicina slab-a: jedna stranica mape stranica (64 KiB).
+    static constexpr size_t kSlabSize = size_class_detail::kSlabSize;
+    static constexpr size_t kCount = size_class_detail::kCount;
+
+    // Najmanja klasa u koju staje size (1 <= size <= kMaxSmallSize).
+    static size_t Index(size_t size) {
+        if (size <= size_class_detail::kLookupLimit) {
+            return size_class_detail::kTable.lookup[(size + size_class_detail::kAlignment - 1) / size_class_detail::kAlignment];
+        }
+        int log2 = 63 - __builtin_clzll(static_cast<unsigned long long>(size - 1));
+        size_t step = static_cast<size_t>(1) << (log2 - 2);
+        size_t sub = (size - 1 - (static_cast<size_t>(1) << log2)) / step;
+        return 17 + static_cast<size_t>(log2 - 8) * 4 + sub;
+    }
+
+    static size_t Size(size_t size_class) { return size_class_detail::kTable.size[size_class]; }
+    // Broj objekata klase u jednom slab-u.
+    static size_t SlabObjects(size_t size_class) { return size_class_detail::kTable.objects[size_class]; }
+};
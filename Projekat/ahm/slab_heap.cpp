@@ -0,0 +1,175 @@
+#ifndef _WIN32
+
+#include "slab_heap.h"
+
+#include <sys/mman.h>
+
+SlabHeap::SlabHeap(size_t heap_index, MmapArena* arena, PageMap* page_map)
+    : heap_index_(heap_index), arena_(arena), page_map_(page_map), empty_(nullptr), clock_(0) {
+    static_assert(sizeof(SegmentHeader) + MmapArena::kRawSegmentOffset <= SizeClasses::kSlabSize,
+        "slab descriptors must fit into the first page of a segment");
+    for (size_t i = 0; i < SizeClasses::kCount; ++i) {
+        partial_[i] = nullptr;
+    }
+}
+
+void* SlabHeap::Allocate(size_t size_class) {
+    Slab* slab = partial_[size_class];
+    if (!slab) {
+        slab = NewSlab(size_class);
+        if (!slab) {
+            return nullptr;
+        }
+    }
+
+    void* ptr = slab->free_list;
+    if (ptr) {
+        slab->free_list = *static_cast<void**>(ptr);
+    } else {
+        ptr = slab->bump;
+        slab->bump += SizeClasses::Size(size_class);
+    }
+    if (--slab->free_count == 0) {
+        // Pun slab izlazi iz liste; vraca se u nju pri prvom Free.
+        Unlink(slab);
+    }
+    return ptr;
+}
+
+void SlabHeap::Free(void* ptr, size_t size_class) {
+    Slab* slab = SlabOf(ptr);
+    *static_cast<void**>(ptr) = slab->free_list;
+    slab->free_list = ptr;
+    if (slab->free_count++ == 0) {
+        Link(slab);
+    }
+
+    // Potpuno prazan slab se vraca u zajednicki skup, osim ako je jedini
+    // slab te klase (da naizmenicni Malloc/Free ne bi stalno menjali klasu).
+    if (slab->free_count == SizeClasses::SlabObjects(size_class) &&
+        (partial_[size_class] != slab || slab->next)) {
+        Unlink(slab);
+        page_map_->Set(PageOf(slab), SizeClasses::kSlabSize, PageMap::Encode(heap_index_, PageMap::kUnusedClass));
+        slab->idle_since = clock_;
+        slab->next = empty_;
+        empty_ = slab;
+    }
+}
+
+size_t SlabHeap::Purge(uint64_t now_ms, uint64_t decay_ms) {
+    clock_ = now_ms;
+    size_t released = 0;
+    for (Slab* slab = empty_; slab; slab = slab->next) {
+        if (slab->idle_since == kPurged || now_ms - slab->idle_since < decay_ms) {
+            continue;
+        }
+        // Nad MAP_HUGETLB segmentom madvise od 64 KiB ne uspeva, pa takav slab ostaje.
+        if (madvise(PageOf(slab), SizeClasses::kSlabSize, MADV_DONTNEED) == 0) {
+            released += SizeClasses::kSlabSize;
+        }
+        slab->idle_since = kPurged;
+    }
+    return released;
+}
+
+size_t SlabHeap::WarmUp(size_t bytes) {
+    size_t populated = 0;
+    for (size_t size_class = 1; size_class < SizeClasses::kCount; ++size_class) {
+        if (partial_[size_class]) {
+            continue;
+        }
+        Slab* slab = NewSlab(size_class);
+        if (!slab) {
+            break;
+        }
+        MmapArena::PopulatePages(PageOf(slab), SizeClasses::kSlabSize);
+        populated += SizeClasses::kSlabSize;
+    }
+
+    size_t empty_bytes = 0;
+    for (Slab* slab = empty_; slab; slab = slab->next) {
+        empty_bytes += SizeClasses::kSlabSize;
+    }
+    while (empty_bytes < bytes && AddSegment()) {
+        empty_bytes += (kSlabsPerSegment - 1) * SizeClasses::kSlabSize;
+    }
+    // NewSlab uzima sa pocetka liste, pa se ucitavaju prvi slab-ovi.
+    size_t ready = 0;
+    for (Slab* slab = empty_; slab && ready < bytes; slab = slab->next) {
+        if (slab->idle_since == kPurged) {
+            MmapArena::PopulatePages(PageOf(slab), SizeClasses::kSlabSize);
+            populated += SizeClasses::kSlabSize;
+            slab->idle_since = clock_;
+        }
+        ready += SizeClasses::kSlabSize;
+    }
+    return populated;
+}
+
+SlabHeap::Slab* SlabHeap::SlabOf(const void* ptr) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+    uintptr_t segment = address & ~(static_cast<uintptr_t>(MmapArena::kSegmentSize) - 1);
+    SegmentHeader* header = reinterpret_cast<SegmentHeader*>(segment + MmapArena::kRawSegmentOffset);
+    return &header->slabs[(address - segment) / SizeClasses::kSlabSize];
+}
+
+char* SlabHeap::PageOf(const Slab* slab) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(slab);
+    uintptr_t segment = address & ~(static_cast<uintptr_t>(MmapArena::kSegmentSize) - 1);
+    const SegmentHeader* header = reinterpret_cast<const SegmentHeader*>(segment + MmapArena::kRawSegmentOffset);
+    return reinterpret_cast<char*>(segment + static_cast<size_t>(slab - header->slabs) * SizeClasses::kSlabSize);
+}
+
+SlabHeap::Slab* SlabHeap::NewSlab(size_t size_class) {
+    if (!empty_ && !AddSegment()) {
+        return nullptr;
+    }
+    Slab* slab = empty_;
+    empty_ = slab->next;
+
+    char* page = PageOf(slab);
+    slab->free_list = nullptr;
+    slab->bump = page;
+    slab->free_count = static_cast<uint32_t>(SizeClasses::SlabObjects(size_class));
+    slab->size_class = static_cast<uint32_t>(size_class);
+    page_map_->Set(page, SizeClasses::kSlabSize, PageMap::Encode(heap_index_, size_class));
+    Link(slab);
+    return slab;
+}
+
+bool SlabHeap::AddSegment() {
+    char* segment = static_cast<char*>(arena_->MapRawSegment(PageMap::Encode(heap_index_, PageMap::kUnusedClass)));
+    if (!segment) {
+        return false;
+    }
+    SegmentHeader* header = reinterpret_cast<SegmentHeader*>(segment + MmapArena::kRawSegmentOffset);
+    for (size_t i = kSlabsPerSegment - 1; i >= 1; --i) {
+        header->slabs[i].idle_since = kPurged;
+        header->slabs[i].next = empty_;
+        empty_ = &header->slabs[i];
+    }
+    return true;
+}
+
+void SlabHeap::Link(Slab* slab) {
+    Slab*& head = partial_[slab->size_class];
+    slab->prev = nullptr;
+    slab->next = head;
+    if (head) {
+        head->prev = slab;
+    }
+    head = slab;
+}
+
+void SlabHeap::Unlink(Slab* slab) {
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    } else {
+        partial_[slab->size_class] = slab->next;
+    }
+    if (slab->next) {
+        slab->next->prev = slab->prev;
+    }
+}
+
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "mmap_arena.h"
+#include "page_map.h"
+#include "size_classes.h"
+
+// Slab alokator za male objekte jednog heap-a (ne-Windows platforme).
+// Slab je jedna stranica mape stranica (64 KiB) podeljena na slotove iste
+// klase velicine. Slab-ovi se uzimaju iz sirovih segmenata arene: prva
+// stranica segmenta cuva deskriptore, ostale su slab-ovi. Klasa slab-a se
+// upisuje u mapu stranica, a deskriptor se nalazi maskiranjem adrese, pa mali
+// objekti nemaju nikakve metapodatke po objektu.
+// Klasa nije thread-safe; poziva se pod zakljucavanjem heap-a.
+class SlabHeap {
+public:
+    SlabHeap(size_t heap_index, MmapArena* arena, PageMap* page_map);
+
+    SlabHeap(const SlabHeap&) = delete;
+    SlabHeap& operator=(const SlabHeap&) = delete;
+
+    void* Allocate(size_t size_class);
+    // size_class je procitan iz mape stranica.
+    void Free(void* ptr, size_t size_class);
+
+    // Prazni slab-ovi neaktivni bar decay_ms (po casovniku now_ms) vracaju
+    // stranice OS-u sa madvise(MADV_DONTNEED). Vraca broj vracenih bajtova.
+    size_t Purge(uint64_t now_ms, uint64_t decay_ms);
+
+    // Svaka klasa koja nema slab sa slobodnim slotom dobija nov, a medju
+    // praznim slab-ovima se bar bytes bajtova drzi sa stranicama u memoriji
+    // (po potrebi uz nove segmente), pa male alokacije ne prolaze kroz mmap
+    // ni page fault. Vraca broj ucitanih bajtova.
+    size_t WarmUp(size_t bytes);
+
+private:
+    static const size_t kSlabsPerSegment = MmapArena::kSegmentSize / SizeClasses::kSlabSize;
+
+    // Deskriptor slab-a. Slobodni slotovi su u intrusivnoj listi, a slotovi
+    // koji jos nisu korisceni se uzimaju pomeranjem bump pokazivaca.
+    struct Slab {
+        Slab* next;
+        Slab* prev;
+        void* free_list;
+        char* bump;
+        uint32_t free_count;
+        uint32_t size_class;
+        // Kada je slab postao prazan (kPurged ako mu stranice nisu u memoriji).
+        uint64_t idle_since;
+    };
+    static const uint64_t kPurged = ~static_cast<uint64_t>(0);
+
+    struct SegmentHeader {
+        // slabs[0] odgovara stranici sa zaglavljem i nikada se ne koristi.
+        Slab slabs[kSlabsPerSegment];
+    };
+
+    static Slab* SlabOf(const void* ptr);
+    static char* PageOf(const Slab* slab);
+
+    Slab* NewSlab(size_t size_class);
+    bool AddSegment();
+    void Link(Slab* slab);
+    void Unlink(Slab* slab);
+
+    size_t heap_index_;
+    MmapArena* arena_;
+    PageMap* page_map_;
+    // Slab-ovi sa bar jednim slobodnim slotom, po klasi.
+    Slab* partial_[SizeClasses::kCount];
+    // Neiskorisceni slab-ovi, spremni za bilo koju klasu.
+    Slab* empty_;
+    // Vreme poslednjeg Purge poziva; njime se oznacavaju novi prazni slab-ovi.
+    uint64_t clock_;
+};
@@ -0,0 +1,195 @@
+#ifndef _WIN32
+
+#include "thread_cache.h"
+
+#include <new>
+
+#include <pthread.h>
+
+namespace {
+const size_t kMaxSlots = 4;
+const size_t kMaxRefill = 32;
+
+// Slotovi niti su POD (__thread) kako pristup ne bi zahtevao alokaciju;
+// izlazak niti se hvata preko pthread kljuca sa destruktorom.
+struct ThreadCacheSlot {
+    ThreadCacheControl* control;
+    ThreadCache* cache;
+};
+
+__thread ThreadCacheSlot tls_slots[kMaxSlots];
+__thread bool tls_exit_registered;
+// Nit upravo kreira ili unistava kes. Ako je menadzer ujedno i malloc procesa
+// (LD_PRELOAD), new/delete kesa i pthread poziv ulaze ponovo u GetThreadCache;
+// tada se radi bez kesa, direktno sa heap-om.
+__thread bool tls_busy;
+
+pthread_key_t g_exit_key;
+pthread_once_t g_exit_key_once = PTHREAD_ONCE_INIT;
+
+void ReleaseControl(ThreadCacheControl* control) {
+    if (control->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete control;
+    }
+}
+
+// Vrati sve blokove menadzeru (ako je ziv), izbaci kes iz liste i oslobodi ga.
+void DestroySlot(ThreadCacheSlot& slot) {
+    ThreadCacheControl* control = slot.control;
+    ThreadCache* cache = slot.cache;
+    {
+        std::lock_guard<std::mutex> lock(control->mutex);
+        if (control->alive.load(std::memory_order_relaxed)) {
+            void* blocks[kMaxRefill];
+            for (size_t bucket = 1; bucket < ThreadCache::kBucketCount; ++bucket) {
+                size_t count = 0;
+                while ((count = cache->Drain(bucket, blocks, kMaxRefill)) > 0) {
+                    control->release(control->context, blocks, count);
+                }
+            }
+        }
+        if (cache->prev) {
+            cache->prev->next = cache->next;
+        } else if (control->caches == cache) {
+            control->caches = cache->next;
+        }
+        if (cache->next) {
+            cache->next->prev = cache->prev;
+        }
+    }
+    // Slot se prazni pre delete, da oslobadjanje samog kesa ne zavrsi u njemu.
+    slot.control = nullptr;
+    slot.cache = nullptr;
+    delete cache;
+    ReleaseControl(control);
+}
+
+void OnThreadExit(void*) {
+    // Nit se gasi: sve sto jos oslobodi ide direktno u heap-ove.
+    tls_busy = true;
+    for (size_t i = 0; i < kMaxSlots; ++i) {
+        if (tls_slots[i].control) {
+            DestroySlot(tls_slots[i]);
+        }
+    }
+}
+
+void CreateExitKey() {
+    pthread_key_create(&g_exit_key, &OnThreadExit);
+}
+
+// Spori deo GetThreadCache: novi kes u slobodnom slotu niti.
+ThreadCache* CreateThreadCache(ThreadCacheControl* control) {
+    ThreadCacheSlot* free_slot = nullptr;
+    for (size_t i = 0; i < kMaxSlots; ++i) {
+        ThreadCacheSlot& slot = tls_slots[i];
+        if (slot.control && !slot.control->alive.load(std::memory_order_acquire)) {
+            // Menadzer je unisten dok je nit ziva - slot moze ponovo da se koristi.
+            DestroySlot(slot);
+        }
+        if (!slot.control && !free_slot) {
+            free_slot = &slot;
+        }
+    }
+    if (!free_slot) {
+        return nullptr;
+    }
+
+    if (!tls_exit_registered) {
+        pthread_once(&g_exit_key_once, &CreateExitKey);
+        pthread_setspecific(g_exit_key, reinterpret_cast<void*>(1));
+        tls_exit_registered = true;
+    }
+
+    ThreadCache* cache = new (std::nothrow) ThreadCache(control->capacity_bytes);
+    if (!cache) {
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(control->mutex);
+        cache->next = control->caches;
+        if (control->caches) {
+            control->caches->prev = cache;
+        }
+        control->caches = cache;
+    }
+    control->references.fetch_add(1, std::memory_order_relaxed);
+    free_slot->control = control;
+    free_slot->cache = cache;
+    return cache;
+}
+}
+
+ThreadCache::ThreadCache(size_t capacity_bytes)
+    : next(nullptr), prev(nullptr), cached_bytes_(0), capacity_bytes_(capacity_bytes) {
+    // Manji blokovi smeju da se gomilaju vise, ali nijedna lista ne uzima
+    // vise od osmine kapaciteta kesa.
+    lists_[0].limit = 0;
+    for (size_t i = 1; i < kBucketCount; ++i) {
+        size_t limit = capacity_bytes / (8 * SizeClasses::Size(i));
+        if (limit < 2) {
+            limit = 2;
+        }
+        if (limit > 256) {
+            limit = 256;
+        }
+        lists_[i].limit = static_cast<uint32_t>(limit);
+    }
+}
+
+size_t ThreadCache::RefillCount(size_t bucket) const {
+    size_t count = lists_[bucket].limit / 2;
+    if (count < 1) {
+        count = 1;
+    }
+    return count > kMaxRefill ? kMaxRefill : count;
+}
+
+size_t ThreadCache::Drain(size_t bucket, void** out, size_t max_count) {
+    size_t count = 0;
+    while (count < max_count) {
+        void* ptr = Pop(bucket);
+        if (!ptr) {
+            break;
+        }
+        out[count++] = ptr;
+    }
+    return count;
+}
+
+void ThreadCache::Discard() {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        lists_[i].head = nullptr;
+        lists_[i].count = 0;
+    }
+    cached_bytes_ = 0;
+}
+
+ThreadCache* GetThreadCache(ThreadCacheControl* control) {
+    for (size_t i = 0; i < kMaxSlots; ++i) {
+        if (tls_slots[i].control == control) {
+            return tls_slots[i].cache;
+        }
+    }
+    if (tls_busy) {
+        return nullptr;
+    }
+    tls_busy = true;
+    ThreadCache* cache = CreateThreadCache(control);
+    tls_busy = false;
+    return cache;
+}
+
+void RetireThreadCacheControl(ThreadCacheControl* control) {
+    {
+        std::lock_guard<std::mutex> lock(control->mutex);
+        control->alive.store(false, std::memory_order_release);
+        // Blokovi pripadaju heap-ovima koji se upravo unistavaju.
+        for (ThreadCache* cache = control->caches; cache; cache = cache->next) {
+            cache->Discard();
+        }
+    }
+    ReleaseControl(control);
+}
+
+#endif
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "size_classes.h"
+
+// Kes slobodnih blokova po niti (ne-Windows platforme).
+// Za svaku klasu velicine (bucket) nit cuva intrusivnu listu slotova koje je
+// vec dobila od slab-ova; uobicajen par Malloc/Free tako ne dira zakljucavanja.
+// Liste se pune i prazne u serijama, pod jednim zakljucavanjem heap-a.
+class ThreadCache {
+public:
+    // Kesiraju se samo mali objekti (slab klase); veci idu direktno u heap.
+    static const size_t kMaxCachedSize = SizeClasses::kMaxSmallSize;
+    static const size_t kBucketCount = SizeClasses::kCount;
+
+    explicit ThreadCache(size_t capacity_bytes);
+
+    ThreadCache(const ThreadCache&) = delete;
+    ThreadCache& operator=(const ThreadCache&) = delete;
+
+    void* Pop(size_t bucket) {
+        FreeList& list = lists_[bucket];
+        void* ptr = list.head;
+        if (ptr) {
+            list.head = *static_cast<void**>(ptr);
+            --list.count;
+            cached_bytes_ -= SizeClasses::Size(bucket);
+        }
+        return ptr;
+    }
+
+    // Vraca true ako lista (ili ceo kes) premasuje ogranicenje i treba je isprazniti.
+    bool Push(size_t bucket, void* ptr) {
+        FreeList& list = lists_[bucket];
+        *static_cast<void**>(ptr) = list.head;
+        list.head = ptr;
+        ++list.count;
+        cached_bytes_ += SizeClasses::Size(bucket);
+        return list.count > list.limit || cached_bytes_ > capacity_bytes_;
+    }
+
+    // Koliko blokova se uzima iz heap-a odjednom kada je lista prazna.
+    size_t RefillCount(size_t bucket) const;
+
+    // Izvadi do max_count blokova iz liste (za vracanje heap-u).
+    size_t Drain(size_t bucket, void** out, size_t max_count);
+    size_t Count(size_t bucket) const { return lists_[bucket].count; }
+
+    // Zaboravi sve blokove bez vracanja (heap-ovi su vec unisteni).
+    void Discard();
+
+    // Veza u listi keseva koje menadzer poznaje.
+    ThreadCache* next;
+    ThreadCache* prev;
+
+private:
+    struct FreeList {
+        void* head = nullptr;
+        uint32_t count = 0;
+        uint32_t limit = 0;
+    };
+
+    FreeList lists_[kBucketCount];
+    size_t cached_bytes_;
+    size_t capacity_bytes_;
+};
+
+// Deljeni kontrolni blok izmedju menadzera i niti koje imaju kes za njega.
+// Nit pri izlasku vraca blokove samo ako je menadzer jos ziv; referenca u
+// kontrolnom bloku sprecava da novi menadzer dobije istu adresu dok neka nit
+// jos drzi stari kes.
+struct ThreadCacheControl {
+    // Vraca seriju blokova menadzeru (poziva se pod mutex-om kontrolnog bloka).
+    typedef void (*ReleaseFn)(void* context, void** blocks, size_t count);
+
+    std::mutex mutex;
+    std::atomic<bool> alive{true};
+    std::atomic<size_t> references{1};
+    void* context = nullptr;
+    ReleaseFn release = nullptr;
+    size_t capacity_bytes = 0;
+    ThreadCache* caches = nullptr;
+};
+
+// Kes trenutne niti za dati kontrolni blok; kreira ga pri prvom pristupu.
+// Vraca nullptr ako nit vec koristi previse razlicitih menadzera.
+ThreadCache* GetThreadCache(ThreadCacheControl* control);
+
+// Poziva menadzer u destruktoru: kesevi postaju mrtvi, a referenca menadzera se pusta.
+void RetireThreadCacheControl(ThreadCacheControl* control);
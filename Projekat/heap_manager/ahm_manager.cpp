@@ -2,9 +2,21 @@
 
 #include "../ahm/ahm.h"
 
+#include <atomic>
+#include <new>
+#include <thread>
+
 // Globalni menadzer, inicijalizuje se jednom u testovima.
 static AdvancedHeapManager* g_manager = nullptr;
 
+// Lenja inicijalizacija: 0 = nema menadzera, 1 = neka nit ga kreira, 2 = spreman.
+// Menadzer se konstruise u staticku memoriju, jer new moze biti bas ovaj malloc.
+static std::atomic<int> g_lazy_state{0};
+alignas(AdvancedHeapManager) static unsigned char g_lazy_storage[sizeof(AdvancedHeapManager)];
+static thread_local bool tls_constructing = false;
+// Da li je zakljucavanje pre fork-a stanje 0 postavilo na 1 (pa ga vraca).
+static bool g_fork_holds_lazy_state = false;
+
 void ManagerInitialization_inicijalizuj_manager(int broj_heapova) {
     if (g_manager != nullptr) {
         return;
@@ -16,8 +28,69 @@ void ManagerInitialization_inicijalizuj_manager(int broj_heapova) {
 }
 
 void ManagerInitialization_deinicijalizuj_manager() {
-    delete g_manager;
+    if (g_manager == reinterpret_cast<AdvancedHeapManager*>(g_lazy_storage)) {
+        g_manager->~AdvancedHeapManager();
+    } else {
+        delete g_manager;
+    }
     g_manager = nullptr;
+    g_lazy_state.store(0, std::memory_order_release);
+}
+
+AdvancedHeapManager* ManagerInitialization_pribavi_manager(int broj_heapova, const char* putanja_traga) {
+    if (g_lazy_state.load(std::memory_order_acquire) == 2) {
+        return g_manager;
+    }
+    if (tls_constructing) {
+        return nullptr;
+    }
+
+    int expected = 0;
+    if (g_lazy_state.compare_exchange_strong(expected, 1, std::memory_order_acq_rel)) {
+        if (g_manager == nullptr) {
+            AdvancedHeapManager::Config config;
+            config.heap_count = broj_heapova > 0 ? static_cast<size_t>(broj_heapova) : 1;
+            config.trace_path = putanja_traga;
+            tls_constructing = true;
+            try {
+                g_manager = new (g_lazy_storage) AdvancedHeapManager(config);
+            } catch (...) {
+                tls_constructing = false;
+                g_lazy_state.store(0, std::memory_order_release);
+                return nullptr;
+            }
+            tls_constructing = false;
+        }
+        g_lazy_state.store(2, std::memory_order_release);
+        return g_manager;
+    }
+
+    // Druga nit vec kreira menadzer: sacekaj je.
+    while (g_lazy_state.load(std::memory_order_acquire) == 1) {
+        std::this_thread::yield();
+    }
+    return g_lazy_state.load(std::memory_order_acquire) == 2 ? g_manager : nullptr;
+}
+
+void ManagerInitialization_zakljucaj_pre_forka() {
+    for (;;) {
+        int expected = 0;
+        if (g_lazy_state.compare_exchange_strong(expected, 1, std::memory_order_acq_rel)) {
+            g_fork_holds_lazy_state = true;
+            return;
+        }
+        if (expected == 2) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void ManagerInitialization_otkljucaj_posle_forka() {
+    if (g_fork_holds_lazy_state) {
+        g_fork_holds_lazy_state = false;
+        g_lazy_state.store(0, std::memory_order_release);
+    }
 }
 
 void* ahm_malloc(size_t size) {
@@ -27,9 +100,62 @@ void* ahm_malloc(size_t size) {
     return g_manager->Malloc(size);
 }
 
+void* ahm_realloc(void* ptr, size_t size) {
+    if (!g_manager) {
+        return nullptr;
+    }
+    return g_manager->Realloc(ptr, size);
+}
+
+void* ahm_calloc(size_t count, size_t size) {
+    if (!g_manager) {
+        return nullptr;
+    }
+    return g_manager->Calloc(count, size);
+}
+
+void* ahm_aligned_alloc(size_t alignment, size_t size) {
+    if (!g_manager) {
+        return nullptr;
+    }
+    return g_manager->MallocAligned(size, alignment);
+}
+
 void ahm_free(void* ptr) {
     if (!g_manager) {
         return;
     }
     g_manager->Free(ptr);
 }
+
+void ahm_free_sized(void* ptr, size_t size) {
+    if (!g_manager) {
+        return;
+    }
+    g_manager->FreeSized(ptr, size);
+}
+
+size_t ahm_malloc_batch(size_t size, size_t count, void** out) {
+    if (!g_manager) {
+        for (size_t i = 0; out && i < count; ++i) {
+            out[i] = nullptr;
+        }
+        return 0;
+    }
+    return g_manager->MallocBatch(size, count, out);
+}
+
+void ahm_free_batch(void** ptrs, size_t count) {
+    if (!g_manager) {
+        return;
+    }
+    g_manager->FreeBatch(ptrs, count);
+}
+
+bool ahm_get_stats(AhmStats* stats) {
+    if (!g_manager || !stats) {
+        return false;
+    }
+    *stats = g_manager->GetStats();
+    return true;
+}
@@ -2,8 +2,32 @@
 
 #include <cstddef>
 
+#include "../ahm/ahm_fwd.h"
+#include "../ahm/ahm_stats.h"
+
 // Jednostavan C interfejs za AHM.
 void ManagerInitialization_inicijalizuj_manager(int broj_heapova);
 void ManagerInitialization_deinicijalizuj_manager();
+// Vraca globalni menadzer i kreira ga pri prvom pozivu, bezbedno iz vise niti
+// i bez operatora new (za zamenu malloc-a). Nit koja je upravo u konstruktoru
+// menadzera dobija nullptr, pa svoje alokacije mora da namiri na drugi nacin.
+// Ako je putanja_traga zadata, menadzer upisuje trag alokacija (Config::trace_path).
+AdvancedHeapManager* ManagerInitialization_pribavi_manager(int broj_heapova, const char* putanja_traga = nullptr);
+// Za pthread_atfork: saceka kreiranje menadzera koje je u toku i ne dozvoljava
+// novo do otkljucavanja (u roditelju i u detetu).
+void ManagerInitialization_zakljucaj_pre_forka();
+void ManagerInitialization_otkljucaj_posle_forka();
 void* ahm_malloc(size_t size);
 void ahm_free(void* ptr);
+// Oslobadjanje uz velicinu prosledjenu ahm_malloc/ahm_calloc/ahm_realloc (ne ahm_aligned_alloc).
+void ahm_free_sized(void* ptr, size_t size);
+void* ahm_realloc(void* ptr, size_t size);
+void* ahm_calloc(size_t count, size_t size);
+// Kao C11 aligned_alloc: alignment je stepen dvojke; blok se oslobadja sa ahm_free.
+void* ahm_aligned_alloc(size_t alignment, size_t size);
+// Serijska alokacija/oslobadjanje: vraca broj alociranih blokova (ostatak out je nullptr).
+size_t ahm_malloc_batch(size_t size, size_t count, void** out);
+void ahm_free_batch(void** ptrs, size_t count);
+// Snimak statistike globalnog menadzera (AdvancedHeapManager::GetStats);
+// vraca false ako menadzer ne postoji.
+bool ahm_get_stats(AhmStats* stats);
@@ -0,0 +1,271 @@
+#ifndef _WIN32
+
+// Zamena malloc familije za LD_PRELOAD:
+//   LD_PRELOAD=./libahm_preload.so ./program
+// Sve alokacije procesa idu kroz globalni menadzer iz ahm_manager.cpp, koji se
+// kreira pri prvoj alokaciji. Broj heap-ova se zadaje promenljivom AHM_HEAPS,
+// a AHM_TRACE=putanja ukljucuje trag alokacija za ahm_replay u fajl
+// putanja.<pid> (svaki proces koji nasledi okruzenje pise svoj fajl; proces
+// obicno ne unistava menadzer, pa fajl ostaje pune velicine, sto citac podnosi).
+// Alokacije koje pravi sam konstruktor menadzera (pre nego sto postoji) uzimaju
+// se iz statickog bafera i nikada se ne oslobadjaju.
+
+#include "ahm_manager.h"
+
+#include "../ahm/ahm.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <malloc.h>
+#include <pthread.h>
+#include <unistd.h>
+
+namespace {
+const size_t kBootstrapSize = 1024 * 1024;
+const size_t kBootstrapHeader = 16;
+const size_t kBootstrapMaxAlignment = 4096;
+
+alignas(kBootstrapMaxAlignment) unsigned char g_bootstrap[kBootstrapSize];
+std::atomic<size_t> g_bootstrap_used{0};
+
+std::atomic<AdvancedHeapManager*> g_preload_manager{nullptr};
+// Menadzer zakljucan pre fork-a; isti se otkljucava posle, cak i ako je
+// g_preload_manager u medjuvremenu postavljen.
+AdvancedHeapManager* g_fork_manager = nullptr;
+
+// pthread_atfork: kao glibc, fork ne sme da se desi dok neka nit drzi bravu
+// alokatora, jer bi je dete nasledilo zakljucanu, bez niti koja je otkljucava.
+void LockBeforeFork() {
+    ManagerInitialization_zakljucaj_pre_forka();
+    g_fork_manager = g_preload_manager.load(std::memory_order_acquire);
+    if (g_fork_manager) {
+        g_fork_manager->LockForFork();
+    }
+}
+
+void UnlockAfterFork() {
+    if (g_fork_manager) {
+        g_fork_manager->UnlockAfterFork();
+        g_fork_manager = nullptr;
+    }
+    ManagerInitialization_otkljucaj_posle_forka();
+}
+
+int HeapCountFromEnvironment() {
+    // getenv i strtol ne alociraju, pa su bezbedni pre nego sto menadzer postoji.
+    const char* value = std::getenv("AHM_HEAPS");
+    if (value) {
+        long count = std::strtol(value, nullptr, 10);
+        if (count > 0 && count <= 0xFFFF) {
+            return static_cast<int>(count);
+        }
+    }
+    return static_cast<int>(AdvancedHeapManager::Config().heap_count);
+}
+
+// Putanja traga iz AHM_TRACE sa dodatim pid-om, ili nullptr. snprintf sa
+// %s i %ld ne alocira.
+const char* TracePathFromEnvironment(char* buffer, size_t size) {
+    const char* value = std::getenv("AHM_TRACE");
+    if (!value || !*value) {
+        return nullptr;
+    }
+    int length = std::snprintf(buffer, size, "%s.%ld", value, static_cast<long>(getpid()));
+    return length > 0 && static_cast<size_t>(length) < size ? buffer : nullptr;
+}
+
+AdvancedHeapManager* Manager() {
+    AdvancedHeapManager* manager = g_preload_manager.load(std::memory_order_acquire);
+    if (manager) {
+        return manager;
+    }
+    // Putanja treba samo konstruktoru menadzera, pa je dovoljan bafer na steku.
+    char trace_path[4096];
+    manager = ManagerInitialization_pribavi_manager(HeapCountFromEnvironment(), TracePathFromEnvironment(trace_path, sizeof(trace_path)));
+    if (manager) {
+        g_preload_manager.store(manager, std::memory_order_release);
+        // Registracija moze da alocira, a menadzer je vec objavljen.
+        static const int fork_handlers = pthread_atfork(&LockBeforeFork, &UnlockAfterFork, &UnlockAfterFork);
+        (void)fork_handlers;
+    }
+    return manager;
+}
+
+// Bump alokacija iz statickog bafera; velicina bloka se cuva ispred njega.
+// Bafer je u .bss, pa je vec popunjen nulama.
+void* BootstrapAllocate(size_t size, size_t alignment) {
+    if (alignment < kBootstrapHeader) {
+        alignment = kBootstrapHeader;
+    }
+    if (alignment > kBootstrapMaxAlignment || size > kBootstrapSize) {
+        return nullptr;
+    }
+    size_t used = g_bootstrap_used.load(std::memory_order_relaxed);
+    size_t begin = 0;
+    do {
+        begin = (used + kBootstrapHeader + alignment - 1) & ~(alignment - 1);
+        if (begin + size > kBootstrapSize) {
+            return nullptr;
+        }
+    } while (!g_bootstrap_used.compare_exchange_weak(used, begin + size, std::memory_order_relaxed));
+
+    std::memcpy(g_bootstrap + begin - sizeof(size_t), &size, sizeof(size_t));
+    return g_bootstrap + begin;
+}
+
+bool IsBootstrap(const void* ptr) {
+    const unsigned char* address = static_cast<const unsigned char*>(ptr);
+    return address >= g_bootstrap && address < g_bootstrap + kBootstrapSize;
+}
+
+size_t BootstrapSize(const void* ptr) {
+    size_t size = 0;
+    std::memcpy(&size, static_cast<const unsigned char*>(ptr) - sizeof(size_t), sizeof(size_t));
+    return size;
+}
+
+void* Allocate(size_t size) {
+    AdvancedHeapManager* manager = Manager();
+    void* ptr = manager ? manager->Malloc(size) : BootstrapAllocate(size, kBootstrapHeader);
+    if (!ptr) {
+        errno = ENOMEM;
+    }
+    return ptr;
+}
+
+void* AllocateAligned(size_t alignment, size_t size) {
+    AdvancedHeapManager* manager = Manager();
+    void* ptr = manager ? manager->MallocAligned(size, alignment) : BootstrapAllocate(size, alignment);
+    if (!ptr) {
+        errno = ENOMEM;
+    }
+    return ptr;
+}
+
+size_t PageSize() {
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+}
+
+extern "C" {
+
+void* malloc(size_t size) noexcept {
+    return Allocate(size);
+}
+
+void free(void* ptr) noexcept {
+    if (!ptr || IsBootstrap(ptr)) {
+        return;
+    }
+    AdvancedHeapManager* manager = Manager();
+    if (manager) {
+        manager->Free(ptr);
+    }
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+    AdvancedHeapManager* manager = Manager();
+    void* ptr = nullptr;
+    if (manager) {
+        ptr = manager->Calloc(count, size);
+    } else if (size == 0 || count <= SIZE_MAX / size) {
+        ptr = BootstrapAllocate(count * size, kBootstrapHeader);
+    }
+    if (!ptr) {
+        errno = ENOMEM;
+    }
+    return ptr;
+}
+
+void* realloc(void* ptr, size_t size) noexcept {
+    if (!ptr) {
+        return Allocate(size);
+    }
+    if (IsBootstrap(ptr)) {
+        // Blok iz bafera se ne menja u mestu: uvek nova alokacija i kopija.
+        if (size == 0) {
+            return nullptr;
+        }
+        void* moved = Allocate(size);
+        if (moved) {
+            size_t old_size = BootstrapSize(ptr);
+            std::memcpy(moved, ptr, old_size < size ? old_size : size);
+        }
+        return moved;
+    }
+    AdvancedHeapManager* manager = Manager();
+    void* moved = manager ? manager->Realloc(ptr, size) : nullptr;
+    if (!moved && size != 0) {
+        errno = ENOMEM;
+    }
+    return moved;
+}
+
+int posix_memalign(void** memptr, size_t alignment, size_t size) noexcept {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    int saved_errno = errno;
+    void* ptr = AllocateAligned(alignment, size);
+    errno = saved_errno;
+    if (!ptr) {
+        return ENOMEM;
+    }
+    *memptr = ptr;
+    return 0;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    return AllocateAligned(alignment, size);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept {
+    // Kao glibc: poravnanje koje nije stepen dvojke zaokruzuje se navise, a
+    // ono za koje sledeci stepen dvojke ne postoji je EINVAL.
+    if (alignment > (SIZE_MAX >> 1) + 1) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    size_t rounded = 1;
+    while (rounded < alignment) {
+        rounded <<= 1;
+    }
+    return AllocateAligned(rounded, size);
+}
+
+void* valloc(size_t size) noexcept {
+    return AllocateAligned(PageSize(), size);
+}
+
+void* pvalloc(size_t size) noexcept {
+    size_t page = PageSize();
+    if (size > SIZE_MAX - page) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    return AllocateAligned(page, (size + page - 1) & ~(page - 1));
+}
+
+size_t malloc_usable_size(void* ptr) noexcept {
+    if (!ptr) {
+        return 0;
+    }
+    if (IsBootstrap(ptr)) {
+        return BootstrapSize(ptr);
+    }
+    AdvancedHeapManager* manager = Manager();
+    return manager ? manager->UsableSize(ptr) : 0;
+}
+
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include "../../ahm/ahm.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <cstdlib>
@@ -13,7 +15,37 @@ struct Options {
     size_t threads = 1;
     size_t total_bytes = 4ull * 1024ull * 1024ull * 1024ull;
     size_t block_size = 1024 * 1024;
+    size_t heap_count = 8;
+    size_t thread_cache_bytes = AdvancedHeapManager::Config().thread_cache_bytes;
     bool use_ahm = true;
+    bool huge_pages = false;
+    // Prag i kes velikih blokova sa sopstvenim mmap regionom (Config::large_*).
+    size_t large_threshold_bytes = AdvancedHeapManager::Config().large_threshold_bytes;
+    size_t large_cache_bytes = AdvancedHeapManager::Config().large_cache_bytes;
+    // Upisuje po jedan bajt na svaku stranicu od 4 KiB svakog bloka, da bi
+    // merenje obuhvatilo page fault-ove i TLB, a ne samo knjigovodstvo alokatora.
+    bool touch = false;
+    // Velicina serije za MallocBatch/FreeBatch (0 = pojedinacni Malloc/Free).
+    size_t batch = 0;
+    // Oslobadja sa FreeSized umesto Free (velicina bloka je poznata).
+    bool sized = false;
+    // Ponavlja merenje za heap_count = 1, 2, 4, ..., 256.
+    bool heap_sweep = false;
+    // Broj niti koje samo oslobadjaju (0 = svaka nit oslobadja svoje blokove).
+    // Tada --threads niti samo alociraju i blokove salju potrosacima.
+    size_t consumers = 0;
+    // Fajl za trag alokacija AHM-a (prazno = bez traga), za ahm_replay.
+    std::string trace_path;
+    // Na kraju ispisuje statistiku menadzera (GetStats).
+    bool stats = false;
+};
+
+struct Result {
+    long long duration_ms = 0;
+    // Najvise zauzet heap u odnosu na prosek, izmereno kada sve niti zavrse
+    // alokaciju (samo uz --heap-sweep).
+    double imbalance = 0.0;
+    AhmStats stats;
 };
 
 Options ParseArgs(int argc, char** argv) {
@@ -26,23 +58,149 @@ Options ParseArgs(int argc, char** argv) {
             options.total_bytes = static_cast<size_t>(std::stoull(argv[++i]));
         } else if (arg == "--block-size" && i + 1 < argc) {
             options.block_size = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--heaps" && i + 1 < argc) {
+            options.heap_count = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--thread-cache" && i + 1 < argc) {
+            options.thread_cache_bytes = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--touch") {
+            options.touch = true;
+        } else if (arg == "--huge-pages") {
+            options.huge_pages = true;
+        } else if (arg == "--large-threshold" && i + 1 < argc) {
+            options.large_threshold_bytes = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--large-cache" && i + 1 < argc) {
+            options.large_cache_bytes = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--batch" && i + 1 < argc) {
+            options.batch = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--sized") {
+            options.sized = true;
+        } else if (arg == "--consumers" && i + 1 < argc) {
+            options.consumers = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--trace" && i + 1 < argc) {
+            options.trace_path = argv[++i];
+        } else if (arg == "--stats") {
+            options.stats = true;
+        } else if (arg == "--heap-sweep") {
+            options.heap_sweep = true;
         } else if (arg == "--malloc") {
             options.use_ahm = false;
         }
     }
     return options;
 }
+
+// Kanal jedan proizvodjac -> jedan potrosac (prsten pokazivaca bez zakljucavanja).
+struct Channel {
+    static const size_t kCapacity = 1024;
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+    void* slots[kCapacity];
+};
+
+// Proizvodjaci alociraju i blokove redom salju potrosacima, koji ih oslobadjaju:
+// kao I/O nit koja prima poruke i radne niti koje ih obradjuju.
+long long RunProducerConsumer(const Options& options, AdvancedHeapManager& ahm) {
+    const size_t producers = options.threads;
+    const size_t consumers = options.consumers;
+    const size_t blocks_per_producer = options.total_bytes / producers / options.block_size;
+    Channel* channels = new Channel[producers * consumers];
+    std::atomic<size_t> producers_done{0};
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::thread* workers = new std::thread[producers + consumers];
+
+    for (size_t p = 0; p < producers; ++p) {
+        workers[p] = std::thread([&, p]() {
+            for (size_t i = 0; i < blocks_per_producer; ++i) {
+                void* ptr = options.use_ahm ? ahm.Malloc(options.block_size) : std::malloc(options.block_size);
+                if (!ptr) {
+                    break;
+                }
+                Channel& channel = channels[p * consumers + i % consumers];
+                size_t tail = channel.tail.load(std::memory_order_relaxed);
+                while (tail - channel.head.load(std::memory_order_acquire) == Channel::kCapacity) {
+                    std::this_thread::yield();
+                }
+                channel.slots[tail % Channel::kCapacity] = ptr;
+                channel.tail.store(tail + 1, std::memory_order_release);
+            }
+            producers_done.fetch_add(1);
+        });
+    }
+
+    for (size_t c = 0; c < consumers; ++c) {
+        workers[producers + c] = std::thread([&, c]() {
+            while (true) {
+                // Proizvodjaci se proveravaju pre praznjenja, da poslednji blokovi ne ostanu u kanalu.
+                bool done = producers_done.load() == producers;
+                size_t received = 0;
+                for (size_t p = 0; p < producers; ++p) {
+                    Channel& channel = channels[p * consumers + c];
+                    size_t head = channel.head.load(std::memory_order_relaxed);
+                    size_t tail = channel.tail.load(std::memory_order_acquire);
+                    for (; head != tail; ++head) {
+                        void* ptr = channel.slots[head % Channel::kCapacity];
+                        if (options.use_ahm && options.sized) {
+                            ahm.FreeSized(ptr, options.block_size);
+                        } else if (options.use_ahm) {
+                            ahm.Free(ptr);
+                        } else {
+                            std::free(ptr);
+                        }
+                        ++received;
+                    }
+                    channel.head.store(head, std::memory_order_release);
+                }
+                if (done && received == 0) {
+                    break;
+                }
+                if (received == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (size_t i = 0; i < producers + consumers; ++i) {
+        workers[i].join();
+    }
+    delete[] workers;
+    delete[] channels;
+
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 }
 
-int main(int argc, char** argv) {
-    Options options = ParseArgs(argc, argv);
+Result RunBenchmark(const Options& options) {
     AdvancedHeapManager::Config config;
-    config.heap_count = 8;
+    config.heap_count = options.heap_count;
+    config.thread_cache_bytes = options.thread_cache_bytes;
+    config.huge_pages = options.huge_pages;
+    config.large_threshold_bytes = options.large_threshold_bytes;
+    config.large_cache_bytes = options.large_cache_bytes;
+    config.trace_path = options.trace_path.empty() ? nullptr : options.trace_path.c_str();
     AdvancedHeapManager ahm(config);
 
+    if (options.consumers > 0) {
+        Result result;
+        result.duration_ms = RunProducerConsumer(options, ahm);
+        if (options.stats) {
+            result.stats = ahm.GetStats();
+        }
+        return result;
+    }
+
     const size_t bytes_per_thread = options.total_bytes / options.threads;
     const size_t blocks_per_thread = bytes_per_thread / options.block_size;
 
+    // Uz --heap-sweep niti cekaju jedna drugu izmedju alokacije i
+    // oslobadjanja, da bi se raspodela po heap-ovima izmerila dok su svi
+    // blokovi zivi; inace cekanje ne ulazi u mereno vreme.
+    const bool measure_imbalance = options.heap_sweep && options.use_ahm;
+    std::atomic<size_t> allocated_threads{0};
+    std::atomic<bool> measured{false};
+    Result result;
+
     auto start = std::chrono::high_resolution_clock::now();
     std::thread* workers = new std::thread[options.threads];
 
@@ -50,26 +208,74 @@ int main(int argc, char** argv) {
         workers[t] = std::thread([&, t]() {
             void** allocations = new void*[blocks_per_thread];
             size_t allocation_count = 0;
+            const bool use_batch = options.use_ahm && options.batch > 0;
 
-            for (size_t i = 0; i < blocks_per_thread; ++i) {
-                void* ptr = nullptr;
-                if (options.use_ahm) {
-                    ptr = ahm.Malloc(options.block_size);
-                } else {
-                    ptr = std::malloc(options.block_size);
+            if (use_batch) {
+                while (allocation_count < blocks_per_thread) {
+                    size_t wanted = std::min(options.batch, blocks_per_thread - allocation_count);
+                    size_t got = ahm.MallocBatch(options.block_size, wanted, allocations + allocation_count);
+                    allocation_count += got;
+                    if (got < wanted) {
+                        break;
+                    }
                 }
+            } else {
+                for (size_t i = 0; i < blocks_per_thread; ++i) {
+                    void* ptr = nullptr;
+                    if (options.use_ahm) {
+                        ptr = ahm.Malloc(options.block_size);
+                    } else {
+                        ptr = std::malloc(options.block_size);
+                    }
 
-                if (!ptr) {
-                    break;
+                    if (!ptr) {
+                        break;
+                    }
+                    allocations[allocation_count++] = ptr;
                 }
-                allocations[allocation_count++] = ptr;
             }
 
-            for (size_t i = 0; i < allocation_count; ++i) {
-                if (options.use_ahm) {
-                    ahm.Free(allocations[i]);
-                } else {
-                    std::free(allocations[i]);
+            if (options.touch) {
+                for (size_t i = 0; i < allocation_count; ++i) {
+                    char* bytes = static_cast<char*>(allocations[i]);
+                    for (size_t offset = 0; offset < options.block_size; offset += 4096) {
+                        bytes[offset] = 1;
+                    }
+                }
+            }
+
+            if (measure_imbalance) {
+                if (allocated_threads.fetch_add(1) + 1 == options.threads) {
+                    size_t total = 0;
+                    size_t maximum = 0;
+                    for (size_t i = 0; i < ahm.HeapCount(); ++i) {
+                        size_t bytes = ahm.AllocatedBytes(i);
+                        total += bytes;
+                        maximum = std::max(maximum, bytes);
+                    }
+                    if (total != 0) {
+                        result.imbalance = static_cast<double>(maximum) * ahm.HeapCount() / total;
+                    }
+                    measured.store(true);
+                }
+                while (!measured.load()) {
+                    std::this_thread::yield();
+                }
+            }
+
+            if (use_batch) {
+                for (size_t i = 0; i < allocation_count; i += options.batch) {
+                    ahm.FreeBatch(allocations + i, std::min(options.batch, allocation_count - i));
+                }
+            } else {
+                for (size_t i = 0; i < allocation_count; ++i) {
+                    if (options.use_ahm && options.sized) {
+                        ahm.FreeSized(allocations[i], options.block_size);
+                    } else if (options.use_ahm) {
+                        ahm.Free(allocations[i]);
+                    } else {
+                        std::free(allocations[i]);
+                    }
                 }
             }
             delete[] allocations;
@@ -82,13 +288,74 @@ int main(int argc, char** argv) {
     delete[] workers;
 
     auto end = std::chrono::high_resolution_clock::now();
-    auto duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    result.duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    if (options.stats) {
+        result.stats = ahm.GetStats();
+    }
+    return result;
+}
+
+void PrintStats(const AhmStats& stats) {
+    const AhmOperationStats& operations = stats.operations;
+    std::cout << "Stats: allocations " << operations.allocations << ", frees " << operations.frees
+              << ", reallocations " << operations.reallocations << ", failed " << operations.failed_allocations << "\n";
+    std::cout << "Stats: live bytes " << stats.live_bytes << ", peak bytes (sum of heaps) " << stats.peak_bytes << "\n";
+    std::cout << "Stats: locks " << stats.lock_acquisitions << ", contended " << stats.contended_locks << "\n";
+    for (size_t i = 0; i < stats.heaps.size(); ++i) {
+        const AhmHeapStats& heap = stats.heaps[i];
+        std::cout << "  heap " << i << ": peak " << heap.peak_bytes << " B, locks " << heap.lock_acquisitions
+                  << ", contended " << heap.contended_locks << "\n";
+    }
+    std::cout << "  sizes:";
+    for (size_t bin = 0; bin < kStatsSizeBins; ++bin) {
+        if (operations.size_bins[bin] != 0) {
+            std::cout << " <=" << (static_cast<uint64_t>(1) << bin) << ":" << operations.size_bins[bin];
+        }
+    }
+    std::cout << "\n";
+}
+}
+
+int main(int argc, char** argv) {
+    Options options = ParseArgs(argc, argv);
 
     std::cout << "Threads: " << options.threads << "\n";
     std::cout << "Total bytes: " << options.total_bytes << "\n";
     std::cout << "Block size: " << options.block_size << "\n";
+
+    if (options.heap_sweep && options.use_ahm) {
+        std::cout << "Allocator: AHM\n";
+        std::cout << "Heaps\tDuration (ms)\tMax/avg heap bytes\n";
+        for (size_t heaps = 1; heaps <= 256; heaps *= 2) {
+            options.heap_count = heaps;
+            Result result = RunBenchmark(options);
+            std::cout << heaps << "\t" << result.duration_ms << "\t" << result.imbalance << "\n";
+        }
+        return 0;
+    }
+
+    Result result = RunBenchmark(options);
+    if (options.use_ahm) {
+        std::cout << "Heaps: " << options.heap_count << "\n";
+        if (options.batch > 0) {
+            std::cout << "Batch: " << options.batch << "\n";
+        }
+        if (options.huge_pages) {
+            std::cout << "Huge pages: on\n";
+        }
+        std::cout << "Large threshold: " << options.large_threshold_bytes << ", large cache: " << options.large_cache_bytes << "\n";
+        if (options.sized) {
+            std::cout << "Free: FreeSized\n";
+        }
+    }
+    if (options.consumers > 0) {
+        std::cout << "Consumers: " << options.consumers << "\n";
+    }
     std::cout << "Allocator: " << (options.use_ahm ? "AHM" : "malloc/free") << "\n";
-    std::cout << "Duration (ms): " << duration_ms << "\n";
+    std::cout << "Duration (ms): " << result.duration_ms << "\n";
+    if (options.use_ahm && options.stats) {
+        PrintStats(result.stats);
+    }
 
     return 0;
 }
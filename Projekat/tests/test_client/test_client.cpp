@@ -4,12 +4,16 @@
 #include "../../ahm/ahm.h"
 
 #include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <cstring>
+#include <deque>
+#include <iomanip>
 #include <iostream>
 #include <random>
 #include <string>
 #include <thread>
+#include <vector>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -18,6 +22,17 @@
 #pragma comment(lib, "Ws2_32.lib")
 #pragma comment(lib, "Mswsock.lib")
 #pragma comment(lib, "AdvApi32.lib")
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
 #endif
 
 namespace {
@@ -27,6 +42,15 @@ struct Options {
     size_t messages = 1000;
     size_t max_message = 64 * 1024;
     bool use_ahm = true;
+    // Generator opterecenja (samo Linux).
+    size_t connections = 1;
+    size_t threads = 1;
+    // Ukupna ciljna brzina u zahtevima u sekundi; 0 je zatvorena petlja.
+    size_t rate = 0;
+    // Najvise zahteva u letu po konekciji (pipelining).
+    size_t depth = 1;
+    size_t duration_ms = 10000;
+    bool json = false;
 };
 
 Options ParseArgs(int argc, char** argv) {
@@ -41,6 +65,18 @@ Options ParseArgs(int argc, char** argv) {
             options.messages = static_cast<size_t>(std::stoull(argv[++i]));
         } else if (arg == "--max-message" && i + 1 < argc) {
             options.max_message = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--connections" && i + 1 < argc) {
+            options.connections = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--rate" && i + 1 < argc) {
+            options.rate = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--depth" && i + 1 < argc) {
+            options.depth = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--duration" && i + 1 < argc) {
+            options.duration_ms = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--json") {
+            options.json = true;
         } else if (arg == "--malloc") {
             options.use_ahm = false;
         }
@@ -76,6 +112,468 @@ bool SendAll(SOCKET socket, const void* buffer, size_t size) {
     }
     return true;
 }
+#else
+// Linux: generator opterecenja. N konekcija je podeljeno na M niti, svaka
+// nit ima svoj epoll i neblokirajuce sokete. Sa --rate zahtevi se zakazuju
+// otvorenom petljom (u fiksnim razmacima, bez obzira na odgovore), a
+// latencija se meri od zakazanog trenutka, pa se kasnjenje servera ne krije
+// (coordinated omission). Bez --rate svaka konekcija drzi --depth zahteva u letu.
+
+uint64_t NowNanoseconds() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Histogram latencija u stilu HDR histograma: za svaki stepen dvojke po 64
+// podjednako siroka bucket-a, pa je relativna greska vrednosti najvise 1/64,
+// a opseg je ceo uint64_t (nanosekunde) u fiksnih 3776 brojaca.
+class LatencyHistogram {
+public:
+    LatencyHistogram() : counts_(kBucketCount, 0) {}
+
+    void Record(uint64_t value) {
+        ++counts_[BucketIndex(value)];
+        ++count_;
+        sum_ += value;
+        max_ = value > max_ ? value : max_;
+    }
+
+    void Merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        count_ += other.count_;
+        sum_ += other.sum_;
+        max_ = other.max_ > max_ ? other.max_ : max_;
+    }
+
+    uint64_t Count() const { return count_; }
+    uint64_t Max() const { return max_; }
+    double Mean() const { return count_ ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0; }
+
+    // Najveca vrednost bucket-a u kome je percentil (kao HDR highestEquivalentValue).
+    uint64_t ValueAtPercentile(double percentile) const {
+        if (count_ == 0) {
+            return 0;
+        }
+        uint64_t target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(count_)));
+        target = target == 0 ? 1 : target;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            seen += counts_[i];
+            if (seen >= target) {
+                uint64_t highest = BucketHighest(i);
+                return highest < max_ ? highest : max_;
+            }
+        }
+        return max_;
+    }
+
+private:
+    static const int kSubBucketBits = 7;
+    static const uint64_t kSubBucketHalf = 1u << (kSubBucketBits - 1);
+    static const size_t kBucketCount = (64 - kSubBucketBits + 2) * kSubBucketHalf;
+
+    static size_t BucketIndex(uint64_t value) {
+        if (value < (1u << kSubBucketBits)) {
+            return static_cast<size_t>(value);
+        }
+        int shift = 63 - __builtin_clzll(value) - kSubBucketBits + 1;
+        return static_cast<size_t>(shift) * kSubBucketHalf + static_cast<size_t>(value >> shift);
+    }
+
+    static uint64_t BucketHighest(size_t index) {
+        if (index < (1u << kSubBucketBits)) {
+            return index;
+        }
+        int shift = static_cast<int>(index / kSubBucketHalf) - 1;
+        uint64_t lowest = static_cast<uint64_t>(index - static_cast<size_t>(shift) * kSubBucketHalf) << shift;
+        return lowest + (static_cast<uint64_t>(1) << shift) - 1;
+    }
+
+    std::vector<uint64_t> counts_;
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+struct LoadConnection {
+    int socket = -1;
+    bool alive = true;
+    // Zakazani trenuci zahteva bez odgovora (u redu i u letu), redom slanja.
+    std::deque<uint64_t> intended;
+    // Zahtevi koji cekaju slanje (dubina je popunjena ili se salje prethodni).
+    size_t queued = 0;
+    // Zahtevi koji su poceli da se salju, a nemaju odgovor.
+    size_t in_flight = 0;
+
+    // Zahtev u slanju (4 bajta duzine + telo).
+    bool writing = false;
+    uint32_t request_length = 0;
+    size_t request_size = 0;
+    size_t request_sent = 0;
+    bool waiting_write = false;
+
+    // Odgovor u prijemu: duzina se sklapa, telo se preskace.
+    uint32_t response_length = 0;
+    size_t header_received = 0;
+    size_t body_remaining = 0;
+};
+
+struct LoadResult {
+    LatencyHistogram latency;
+    size_t sent = 0;
+    size_t completed = 0;
+    size_t errors = 0;
+    // Zakazani zahtevi koji su morali da cekaju jer je dubina bila puna.
+    size_t delayed = 0;
+    // Zakazani zahtevi koji do kraja merenja nisu ni poslati (server ne stize).
+    size_t unsent = 0;
+    size_t bytes_sent = 0;
+    size_t bytes_received = 0;
+};
+
+class LoadThread {
+public:
+    LoadThread(AdvancedHeapManager& ahm, const Options& options, size_t thread_index, size_t connection_count)
+        : ahm_(ahm), options_(options), connections_(connection_count), rng_(static_cast<unsigned int>(thread_index + 1)),
+          request_sizes_(1, options.max_message), thread_index_(thread_index) {
+        payload_ = static_cast<char*>(Allocate(options.max_message));
+        scratch_ = static_cast<char*>(Allocate(kScratchSize));
+        if (payload_) {
+            std::memset(payload_, 0x5A, options.max_message);
+        }
+    }
+
+    ~LoadThread() {
+        for (LoadConnection& connection : connections_) {
+            if (connection.socket >= 0) {
+                close(connection.socket);
+            }
+        }
+        if (epoll_fd_ >= 0) {
+            close(epoll_fd_);
+        }
+        Release(payload_);
+        Release(scratch_);
+    }
+
+    LoadThread(const LoadThread&) = delete;
+    LoadThread& operator=(const LoadThread&) = delete;
+
+    // Povezuje sve konekcije niti (blokirajuci connect, pa neblokirajuci soket).
+    bool Connect(const sockaddr_in& server) {
+        epoll_fd_ = epoll_create1(0);
+        if (epoll_fd_ < 0 || !payload_ || !scratch_) {
+            return false;
+        }
+        for (LoadConnection& connection : connections_) {
+            connection.socket = socket(AF_INET, SOCK_STREAM, 0);
+            if (connection.socket < 0 ||
+                connect(connection.socket, reinterpret_cast<const sockaddr*>(&server), sizeof(server)) != 0) {
+                return false;
+            }
+            int no_delay = 1;
+            setsockopt(connection.socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+            fcntl(connection.socket, F_SETFL, fcntl(connection.socket, F_GETFL, 0) | O_NONBLOCK);
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.ptr = &connection;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, connection.socket, &event) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Salje do end_ns, zatim jos najvise kDrainNanoseconds ceka odgovore u letu.
+    void Run(uint64_t start_ns, uint64_t end_ns) {
+        const bool open_loop = options_.rate > 0;
+        // Nit dobija svoj deo ukupne brzine; niti su pomerene za deo razmaka.
+        const double interval = open_loop ? 1e9 * static_cast<double>(options_.threads) / static_cast<double>(options_.rate) : 0.0;
+        double next_due = static_cast<double>(start_ns) + interval * static_cast<double>(thread_index_) / static_cast<double>(options_.threads);
+        size_t next_connection = 0;
+
+        if (!open_loop) {
+            for (LoadConnection& connection : connections_) {
+                Refill(connection, start_ns);
+            }
+        }
+
+        const int kMaxEvents = 256;
+        epoll_event events[kMaxEvents];
+        bool stopping = false;
+        uint64_t drain_deadline = 0;
+        while (true) {
+            uint64_t now = NowNanoseconds();
+            if (!stopping && now >= end_ns) {
+                stopping = true;
+                drain_deadline = now + kDrainNanoseconds;
+            }
+            if (stopping && (Outstanding() == 0 || now >= drain_deadline)) {
+                break;
+            }
+
+            if (open_loop && !stopping) {
+                // Svi zahtevi ciji je trenutak prosao, redom po konekcijama.
+                while (next_due <= static_cast<double>(now) && next_due < static_cast<double>(end_ns)) {
+                    LoadConnection& connection = connections_[next_connection];
+                    next_connection = (next_connection + 1) % connections_.size();
+                    if (connection.alive) {
+                        Schedule(connection, static_cast<uint64_t>(next_due));
+                    }
+                    next_due += interval;
+                }
+            }
+
+            uint64_t wake = stopping ? drain_deadline : end_ns;
+            if (open_loop && !stopping && next_due < static_cast<double>(wake)) {
+                wake = static_cast<uint64_t>(next_due);
+            }
+            int count = Wait(events, kMaxEvents, wake > now ? wake - now : 0);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                // Bez epoll-a se nista ne moze dovrsiti: preostali zahtevi su greske.
+                std::cerr << "epoll_wait neuspesan: " << std::strerror(errno) << "\n";
+                break;
+            }
+            for (int i = 0; i < count; ++i) {
+                LoadConnection& connection = *static_cast<LoadConnection*>(events[i].data.ptr);
+                if (!connection.alive) {
+                    continue;
+                }
+                if (events[i].events & EPOLLIN) {
+                    OnReadable(connection, stopping);
+                }
+                if (connection.alive && (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+                    Send(connection);
+                }
+            }
+        }
+        // Poslati zahtevi bez odgovora posle isteka cekanja su greske.
+        for (const LoadConnection& connection : connections_) {
+            if (connection.alive) {
+                result_.errors += connection.in_flight;
+                result_.unsent += connection.queued;
+            }
+        }
+    }
+
+    const LoadResult& Result() const { return result_; }
+
+private:
+    static const size_t kScratchSize = 64 * 1024;
+    static const uint64_t kDrainNanoseconds = 2000000000ull;
+
+    // Ceka dogadjaje najvise wait_ns. epoll_pwait2 (Linux 5.11+) prima rok u
+    // nanosekundama; stariji kernel vraca ENOSYS, pa se od tada koristi
+    // epoll_wait sa rokom u milisekundama, zaokruzenim navise da petlja ne
+    // bi vrtela u prazno pre roka (najvise sekund, rok se ionako racuna
+    // ponovo). Greska se vraca kao -1 uz errno.
+    int Wait(epoll_event* events, int max_events, uint64_t wait_ns) {
+        if (use_pwait2_) {
+            timespec timeout{};
+            timeout.tv_sec = static_cast<time_t>(wait_ns / 1000000000ull);
+            timeout.tv_nsec = static_cast<long>(wait_ns % 1000000000ull);
+            int count = epoll_pwait2(epoll_fd_, events, max_events, &timeout, nullptr);
+            if (count >= 0 || errno != ENOSYS) {
+                return count;
+            }
+            use_pwait2_ = false;
+        }
+        uint64_t wait_ms = (wait_ns + 999999) / 1000000;
+        return epoll_wait(epoll_fd_, events, max_events, static_cast<int>(wait_ms < 1000 ? wait_ms : 1000));
+    }
+
+    void* Allocate(size_t size) {
+        return options_.use_ahm ? ahm_.Malloc(size) : std::malloc(size);
+    }
+
+    void Release(void* ptr) {
+        if (options_.use_ahm) {
+            ahm_.Free(ptr);
+        } else {
+            std::free(ptr);
+        }
+    }
+
+    size_t Outstanding() const {
+        size_t outstanding = 0;
+        for (const LoadConnection& connection : connections_) {
+            if (connection.alive) {
+                outstanding += connection.intended.size();
+            }
+        }
+        return outstanding;
+    }
+
+    void Schedule(LoadConnection& connection, uint64_t intended_ns) {
+        connection.intended.push_back(intended_ns);
+        ++connection.queued;
+        if (connection.in_flight >= options_.depth || connection.writing) {
+            ++result_.delayed;
+        }
+        Send(connection);
+    }
+
+    // Zatvorena petlja: dopuni konekciju do --depth zahteva.
+    void Refill(LoadConnection& connection, uint64_t now) {
+        while (connection.alive && connection.intended.size() < options_.depth) {
+            connection.intended.push_back(now);
+            ++connection.queued;
+        }
+        Send(connection);
+    }
+
+    // Salje zahteve iz reda dok ima mesta u dubini i soket prima podatke.
+    void Send(LoadConnection& connection) {
+        const size_t header_size = sizeof(connection.request_length);
+        while (connection.writing || (connection.queued > 0 && connection.in_flight < options_.depth)) {
+            if (!connection.writing) {
+                --connection.queued;
+                ++connection.in_flight;
+                connection.writing = true;
+                connection.request_size = request_sizes_(rng_);
+                connection.request_length = htonl(static_cast<uint32_t>(connection.request_size));
+                connection.request_sent = 0;
+            }
+            iovec parts[2];
+            int part_count = 0;
+            if (connection.request_sent < header_size) {
+                parts[part_count].iov_base = reinterpret_cast<char*>(&connection.request_length) + connection.request_sent;
+                parts[part_count].iov_len = header_size - connection.request_sent;
+                ++part_count;
+            }
+            size_t body_sent = connection.request_sent > header_size ? connection.request_sent - header_size : 0;
+            parts[part_count].iov_base = payload_ + body_sent;
+            parts[part_count].iov_len = connection.request_size - body_sent;
+            ++part_count;
+
+            msghdr message{};
+            message.msg_iov = parts;
+            message.msg_iovlen = static_cast<size_t>(part_count);
+            ssize_t result = sendmsg(connection.socket, &message, MSG_NOSIGNAL);
+            if (result < 0) {
+                if (errno == EAGAIN) {
+                    SetWaitingWrite(connection, true);
+                    return;
+                }
+                Fail(connection);
+                return;
+            }
+            connection.request_sent += static_cast<size_t>(result);
+            if (connection.request_sent == header_size + connection.request_size) {
+                connection.writing = false;
+                ++result_.sent;
+                result_.bytes_sent += connection.request_size;
+            }
+        }
+        SetWaitingWrite(connection, false);
+    }
+
+    void OnReadable(LoadConnection& connection, bool stopping) {
+        while (true) {
+            ssize_t result = recv(connection.socket, scratch_, kScratchSize, 0);
+            if (result < 0 && errno == EAGAIN) {
+                break;
+            }
+            if (result <= 0) {
+                Fail(connection);
+                return;
+            }
+            const char* data = scratch_;
+            size_t size = static_cast<size_t>(result);
+            uint64_t now = NowNanoseconds();
+            while (size > 0) {
+                if (connection.header_received < sizeof(connection.response_length)) {
+                    size_t count = sizeof(connection.response_length) - connection.header_received;
+                    count = count < size ? count : size;
+                    std::memcpy(reinterpret_cast<char*>(&connection.response_length) + connection.header_received, data, count);
+                    connection.header_received += count;
+                    data += count;
+                    size -= count;
+                    if (connection.header_received < sizeof(connection.response_length)) {
+                        break;
+                    }
+                    connection.body_remaining = ntohl(connection.response_length);
+                } else {
+                    size_t count = connection.body_remaining < size ? connection.body_remaining : size;
+                    connection.body_remaining -= count;
+                    data += count;
+                    size -= count;
+                }
+                if (connection.body_remaining == 0) {
+                    // Ceo odgovor: latencija od zakazanog trenutka zahteva.
+                    if (connection.in_flight == 0 || connection.intended.empty()) {
+                        Fail(connection);
+                        return;
+                    }
+                    result_.latency.Record(now - connection.intended.front());
+                    connection.intended.pop_front();
+                    --connection.in_flight;
+                    ++result_.completed;
+                    result_.bytes_received += ntohl(connection.response_length);
+                    connection.header_received = 0;
+                }
+            }
+        }
+        if (options_.rate == 0 && !stopping) {
+            Refill(connection, NowNanoseconds());
+        } else {
+            Send(connection);
+        }
+    }
+
+    void SetWaitingWrite(LoadConnection& connection, bool waiting) {
+        if (connection.waiting_write == waiting) {
+            return;
+        }
+        epoll_event event{};
+        event.events = waiting ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.ptr = &connection;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.socket, &event);
+        connection.waiting_write = waiting;
+    }
+
+    // Konekcija je prekinuta: njeni zahtevi bez odgovora su greske.
+    void Fail(LoadConnection& connection) {
+        result_.errors += connection.intended.size();
+        connection.intended.clear();
+        connection.queued = 0;
+        connection.in_flight = 0;
+        connection.alive = false;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, connection.socket, nullptr);
+        close(connection.socket);
+        connection.socket = -1;
+    }
+
+    AdvancedHeapManager& ahm_;
+    const Options& options_;
+    std::vector<LoadConnection> connections_;
+    std::mt19937 rng_;
+    std::uniform_int_distribution<size_t> request_sizes_;
+    size_t thread_index_;
+    int epoll_fd_ = -1;
+    // false posle prvog ENOSYS iz epoll_pwait2.
+    bool use_pwait2_ = true;
+    char* payload_ = nullptr;
+    char* scratch_ = nullptr;
+    LoadResult result_;
+};
+
+void RaiseFileLimit() {
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+double Microseconds(uint64_t nanoseconds) {
+    return static_cast<double>(nanoseconds) / 1000.0;
+}
 #endif
 }
 
@@ -86,8 +584,101 @@ int main(int argc, char** argv) {
     AdvancedHeapManager ahm(config);
 
 #ifndef _WIN32
-    std::cerr << "Ovaj test klijent zahteva Windows Winsock.\n";
-    return 1;
+    options.connections = options.connections ? options.connections : 1;
+    options.threads = options.threads ? options.threads : 1;
+    options.threads = options.threads < options.connections ? options.threads : options.connections;
+    options.depth = options.depth ? options.depth : 1;
+    options.max_message = options.max_message ? options.max_message : 1;
+    RaiseFileLimit();
+
+    sockaddr_in server{};
+    server.sin_family = AF_INET;
+    server.sin_port = htons(options.port);
+    if (inet_pton(AF_INET, options.host.c_str(), &server.sin_addr) != 1) {
+        std::cerr << "Neispravna adresa: " << options.host << "\n";
+        return 1;
+    }
+
+    // Konekcije se dele nitima sto ravnomernije.
+    std::vector<LoadThread*> load_threads;
+    bool connected = true;
+    for (size_t t = 0; t < options.threads && connected; ++t) {
+        size_t count = options.connections / options.threads + (t < options.connections % options.threads ? 1 : 0);
+        load_threads.push_back(new LoadThread(ahm, options, t, count));
+        connected = load_threads.back()->Connect(server);
+    }
+    if (!connected) {
+        std::cerr << "connect neuspesan.\n";
+        for (LoadThread* load_thread : load_threads) {
+            delete load_thread;
+        }
+        return 1;
+    }
+
+    uint64_t start_ns = NowNanoseconds();
+    uint64_t end_ns = start_ns + static_cast<uint64_t>(options.duration_ms) * 1000000ull;
+    std::vector<std::thread> workers;
+    for (LoadThread* load_thread : load_threads) {
+        workers.emplace_back([load_thread, start_ns, end_ns]() { load_thread->Run(start_ns, end_ns); });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    double elapsed_s = static_cast<double>(NowNanoseconds() - start_ns) / 1e9;
+
+    LoadResult total;
+    for (LoadThread* load_thread : load_threads) {
+        const LoadResult& result = load_thread->Result();
+        total.latency.Merge(result.latency);
+        total.sent += result.sent;
+        total.completed += result.completed;
+        total.errors += result.errors;
+        total.delayed += result.delayed;
+        total.unsent += result.unsent;
+        total.bytes_sent += result.bytes_sent;
+        total.bytes_received += result.bytes_received;
+        delete load_thread;
+    }
+    double throughput = elapsed_s > 0 ? static_cast<double>(total.completed) / elapsed_s : 0.0;
+    const LatencyHistogram& latency = total.latency;
+    std::cout << std::fixed << std::setprecision(1);
+
+    if (options.json) {
+        std::cout << "{\"connections\":" << options.connections
+            << ",\"threads\":" << options.threads
+            << ",\"depth\":" << options.depth
+            << ",\"target_rate\":" << options.rate
+            << ",\"duration_ms\":" << options.duration_ms
+            << ",\"max_message\":" << options.max_message
+            << ",\"sent\":" << total.sent
+            << ",\"completed\":" << total.completed
+            << ",\"errors\":" << total.errors
+            << ",\"delayed\":" << total.delayed
+            << ",\"unsent\":" << total.unsent
+            << ",\"bytes_sent\":" << total.bytes_sent
+            << ",\"bytes_received\":" << total.bytes_received
+            << ",\"throughput\":" << throughput
+            << ",\"latency_us\":{\"p50\":" << Microseconds(latency.ValueAtPercentile(50.0))
+            << ",\"p90\":" << Microseconds(latency.ValueAtPercentile(90.0))
+            << ",\"p99\":" << Microseconds(latency.ValueAtPercentile(99.0))
+            << ",\"p999\":" << Microseconds(latency.ValueAtPercentile(99.9))
+            << ",\"max\":" << Microseconds(latency.Max())
+            << ",\"mean\":" << latency.Mean() / 1000.0 << "}}\n";
+    } else {
+        std::cout << "Konekcije: " << options.connections << ", niti: " << options.threads
+            << ", dubina: " << options.depth << ", ciljna brzina: "
+            << (options.rate ? std::to_string(options.rate) + " zahteva/s" : std::string("zatvorena petlja")) << "\n";
+        std::cout << "Zahtevi: poslato=" << total.sent << " zavrseno=" << total.completed
+            << " greske=" << total.errors << " odlozeno=" << total.delayed << " neposlato=" << total.unsent << "\n";
+        std::cout << "Ostvarena brzina: " << throughput << " zahteva/s (" << elapsed_s << " s)\n";
+        std::cout << "Latencija (us): p50=" << Microseconds(latency.ValueAtPercentile(50.0))
+            << " p90=" << Microseconds(latency.ValueAtPercentile(90.0))
+            << " p99=" << Microseconds(latency.ValueAtPercentile(99.0))
+            << " p999=" << Microseconds(latency.ValueAtPercentile(99.9))
+            << " max=" << Microseconds(latency.Max())
+            << " srednja=" << latency.Mean() / 1000.0 << "\n";
+    }
+    return total.errors == 0 ? 0 : 2;
 #else
     WSADATA wsa_data;
     if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
@@ -0,0 +1,205 @@
+#include "../../ahm/ahm_allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Poredi kontejnere standardne biblioteke na std::allocator-u (malloc) i na
+// AHM-u: AhmAllocator (heap bira menadzer), AhmAllocator vezan za heap niti i
+// std::pmr kontejneri nad AhmMemoryResource. Opterecenja:
+//  - unordered_map i map: --ops operacija nad kljucevima iz [0, --keys), a
+//    postojeci kljuc se brise, nepostojeci upisuje (cvor po operaciji);
+//  - string: --ops nizova sastavljenih dopisivanjem reci do duzine do
+//    --max-string, u prstenu od --window nizova (stari se oslobadja).
+// Svaka od --threads niti ima svoje kontejnere; od --repeat ponavljanja
+// uzima se najbrze.
+namespace {
+struct Options {
+    size_t threads = 1;
+    size_t operations = 1000000;
+    size_t keys = 65536;
+    size_t max_string = 256;
+    size_t window = 1024;
+    size_t heap_count = 4;
+    size_t repeat = 3;
+};
+
+Options ParseArgs(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            options.threads = std::max<size_t>(1, static_cast<size_t>(std::stoull(argv[++i])));
+        } else if (arg == "--ops" && i + 1 < argc) {
+            options.operations = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--keys" && i + 1 < argc) {
+            options.keys = std::max<size_t>(1, static_cast<size_t>(std::stoull(argv[++i])));
+        } else if (arg == "--max-string" && i + 1 < argc) {
+            options.max_string = std::max<size_t>(1, static_cast<size_t>(std::stoull(argv[++i])));
+        } else if (arg == "--window" && i + 1 < argc) {
+            options.window = std::max<size_t>(1, static_cast<size_t>(std::stoull(argv[++i])));
+        } else if (arg == "--heaps" && i + 1 < argc) {
+            options.heap_count = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            options.repeat = std::max<size_t>(1, static_cast<size_t>(std::stoull(argv[++i])));
+        }
+    }
+    return options;
+}
+
+enum class Workload { kUnorderedMap, kMap, kString };
+
+const char* const kWorkloadNames[] = {"unordered_map", "map", "string"};
+
+// Zbir rezultata niti, da kompajler ne izbaci opterecenje.
+std::atomic<uint64_t> g_checksum{0};
+
+template <typename TAlloc, typename T>
+using Rebind = typename std::allocator_traits<TAlloc>::template rebind_alloc<T>;
+
+template <typename TAlloc>
+uint64_t RunUnorderedMap(const Options& options, const TAlloc& alloc, uint64_t seed) {
+    using Value = std::pair<const uint64_t, uint64_t>;
+    Rebind<TAlloc, Value> node_alloc(alloc);
+    std::unordered_map<uint64_t, uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t>, Rebind<TAlloc, Value>> map(
+        0, std::hash<uint64_t>(), std::equal_to<uint64_t>(), node_alloc);
+    std::mt19937_64 rng(seed);
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < options.operations; ++i) {
+        uint64_t key = rng() % options.keys;
+        auto it = map.find(key);
+        if (it != map.end()) {
+            checksum += it->second;
+            map.erase(it);
+        } else {
+            map.emplace(key, i);
+        }
+    }
+    return checksum + map.size();
+}
+
+template <typename TAlloc>
+uint64_t RunMap(const Options& options, const TAlloc& alloc, uint64_t seed) {
+    using Value = std::pair<const uint64_t, uint64_t>;
+    Rebind<TAlloc, Value> node_alloc(alloc);
+    std::map<uint64_t, uint64_t, std::less<uint64_t>, Rebind<TAlloc, Value>> map(std::less<uint64_t>(), node_alloc);
+    std::mt19937_64 rng(seed);
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < options.operations; ++i) {
+        uint64_t key = rng() % options.keys;
+        auto it = map.find(key);
+        if (it != map.end()) {
+            checksum += it->second;
+            map.erase(it);
+        } else {
+            map.emplace(key, i);
+        }
+    }
+    return checksum + map.size();
+}
+
+template <typename TAlloc>
+uint64_t RunString(const Options& options, const TAlloc& alloc, uint64_t seed) {
+    using String = std::basic_string<char, std::char_traits<char>, Rebind<TAlloc, char>>;
+    static const char* const kWords[] = {"GET ", "/index.html ", "HTTP/1.1\r\n", "Host: ", "localhost\r\n",
+        "Content-Length: ", "4096", "\r\n", "Connection: keep-alive\r\n", "X: y\r\n"};
+    const size_t word_count = sizeof(kWords) / sizeof(kWords[0]);
+
+    Rebind<TAlloc, char> char_alloc(alloc);
+    Rebind<TAlloc, String> ring_alloc(alloc);
+    std::vector<String, Rebind<TAlloc, String>> ring(ring_alloc);
+    ring.reserve(options.window);
+    std::mt19937_64 rng(seed);
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < options.operations; ++i) {
+        size_t length = 1 + rng() % options.max_string;
+        String text(char_alloc);
+        while (text.size() < length) {
+            text += kWords[rng() % word_count];
+        }
+        checksum += text.size();
+        if (ring.size() < options.window) {
+            ring.push_back(std::move(text));
+        } else {
+            ring[i % options.window] = std::move(text);
+        }
+    }
+    return checksum;
+}
+
+template <typename TAlloc>
+uint64_t RunWorkload(const Options& options, Workload workload, const TAlloc& alloc, uint64_t seed) {
+    switch (workload) {
+    case Workload::kUnorderedMap:
+        return RunUnorderedMap(options, alloc, seed);
+    case Workload::kMap:
+        return RunMap(options, alloc, seed);
+    default:
+        return RunString(options, alloc, seed);
+    }
+}
+
+// make(t) daje alokator niti t; vraca najkrace vreme od --repeat merenja (ms).
+template <typename TMakeAlloc>
+double Measure(const Options& options, Workload workload, TMakeAlloc make) {
+    double best = 0.0;
+    for (size_t r = 0; r < options.repeat; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < options.threads; ++t) {
+            workers.emplace_back([&, t]() {
+                auto alloc = make(t);
+                g_checksum.fetch_add(RunWorkload(options, workload, alloc, t + 1));
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        double duration_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (r == 0 || duration_ms < best) {
+            best = duration_ms;
+        }
+    }
+    return best;
+}
+}
+
+int main(int argc, char** argv) {
+    Options options = ParseArgs(argc, argv);
+    AdvancedHeapManager::Config config;
+    config.heap_count = options.heap_count;
+    AdvancedHeapManager ahm(config);
+    AhmMemoryResource resource(ahm);
+
+    std::cout << "Threads: " << options.threads << ", operations per thread: " << options.operations << " (keys "
+              << options.keys << ", strings up to " << options.max_string << " in window " << options.window
+              << "), best of " << options.repeat << "\n";
+    std::cout << "Heaps: " << options.heap_count << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::left << std::setw(16) << "Workload" << std::right << std::setw(16) << "std (ms)"
+              << std::setw(16) << "AhmAllocator" << std::setw(16) << "heap/thread" << std::setw(16) << "pmr AHM" << "\n";
+
+    for (Workload workload : {Workload::kUnorderedMap, Workload::kMap, Workload::kString}) {
+        double standard = Measure(options, workload, [](size_t) { return std::allocator<char>(); });
+        double any_heap = Measure(options, workload, [&](size_t) { return AhmAllocator<char>(ahm); });
+        double thread_heap = Measure(options, workload, [&](size_t t) { return AhmAllocator<char>(ahm, t % ahm.HeapCount()); });
+        double pmr = Measure(options, workload, [&](size_t) { return std::pmr::polymorphic_allocator<char>(&resource); });
+        std::cout << std::left << std::setw(16) << kWorkloadNames[static_cast<size_t>(workload)] << std::right
+                  << std::setw(16) << standard << std::setw(16) << any_heap << std::setw(16) << thread_heap
+                  << std::setw(16) << pmr << "\n";
+    }
+    std::cout << "Checksum: " << g_checksum.load() << "\n";
+    return 0;
+}
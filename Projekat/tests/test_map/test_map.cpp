@@ -0,0 +1,133 @@
+#include "../../ahm/allocation_map.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Mikrobenchmark mape alokacija: Insert/Find/Erase nad N zivih pokazivaca,
+// uporedo sa std::unordered_map kao referencom.
+namespace {
+struct Options {
+    size_t count = 1000000;
+};
+
+Options ParseArgs(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--count" && i + 1 < argc) {
+            options.count = static_cast<size_t>(std::stoull(argv[++i]));
+        }
+    }
+    return options;
+}
+
+struct Value {
+    size_t heap_index = 0;
+    size_t size_bytes = 0;
+};
+
+// Adrese nalik na one iz alokatora: poravnate na 16 bajtova, nasumicnog reda.
+std::vector<void*> MakeKeys(size_t count, uintptr_t base, std::mt19937_64& rng) {
+    std::vector<void*> keys(count);
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = reinterpret_cast<void*>(base + i * 48);
+    }
+    std::shuffle(keys.begin(), keys.end(), rng);
+    return keys;
+}
+
+template <typename TFunc>
+double MeasureNs(size_t operations, TFunc func) {
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / operations;
+}
+
+// Omotac da bi obe mape imale isti interfejs u benchmark-u.
+class StdMap {
+public:
+    void Insert(void* key, const Value& value) { map_[key] = value; }
+    bool Find(void* key, Value& value) const {
+        auto it = map_.find(key);
+        if (it == map_.end()) {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+    bool Erase(void* key) { return map_.erase(key) != 0; }
+
+private:
+    std::unordered_map<void*, Value> map_;
+};
+
+template <typename TMap>
+void RunBenchmark(const char* name, const Options& options) {
+    std::mt19937_64 rng(42);
+    std::vector<void*> keys = MakeKeys(options.count, 0x10000000, rng);
+    std::vector<void*> missing = MakeKeys(options.count, 0x7f0000000000, rng);
+    TMap* map = new TMap();
+    size_t found = 0;
+
+    double insert_ns = MeasureNs(options.count, [&]() {
+        for (size_t i = 0; i < options.count; ++i) {
+            map->Insert(keys[i], Value{i & 7, i});
+        }
+    });
+
+    std::shuffle(keys.begin(), keys.end(), rng);
+    double find_ns = MeasureNs(options.count, [&]() {
+        Value value;
+        for (size_t i = 0; i < options.count; ++i) {
+            found += map->Find(keys[i], value) ? 1 : 0;
+        }
+    });
+
+    double miss_ns = MeasureNs(options.count, [&]() {
+        Value value;
+        for (size_t i = 0; i < options.count; ++i) {
+            found += map->Find(missing[i], value) ? 1 : 0;
+        }
+    });
+
+    // Stabilno stanje: oslobodi jedan pa alociraj drugi, broj zivih ostaje N.
+    double churn_ns = MeasureNs(options.count, [&]() {
+        for (size_t i = 0; i < options.count; ++i) {
+            map->Erase(keys[i]);
+            map->Insert(missing[i], Value{i & 7, i});
+        }
+    });
+
+    double erase_ns = MeasureNs(options.count, [&]() {
+        for (size_t i = 0; i < options.count; ++i) {
+            map->Erase(missing[i]);
+        }
+    });
+
+    delete map;
+
+    std::cout << name << "\t" << insert_ns << "\t" << find_ns << "\t" << miss_ns << "\t" << churn_ns << "\t"
+              << erase_ns << "\n";
+    if (found != options.count) {
+        std::cout << "  unexpected find count: " << found << "\n";
+    }
+}
+}
+
+int main(int argc, char** argv) {
+    Options options = ParseArgs(argc, argv);
+
+    std::cout << "Live pointers: " << options.count << "\n";
+    std::cout << "Map\tInsert\tFind\tFind miss\tErase+Insert\tErase (ns/op)\n";
+    RunBenchmark<AllocationMap<Value>>("AllocationMap", options);
+    RunBenchmark<StdMap>("unordered_map", options);
+
+    return 0;
+}
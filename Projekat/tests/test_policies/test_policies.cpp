@@ -0,0 +1,194 @@
+#include "../../ahm/ahm.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Poredi kombinacije politika BasicHeapManager-a (zakljucavanje x balansiranje)
+// na istom opterecenju: svaka nit u krugovima alocira --batch blokova
+// log-uniformne velicine do --max-size i oslobadja ih izmesanim redom. Meri se
+// vreme za jednu nit (tu NullLock dolazi do izrazaja) i za --threads niti, kao
+// i neravnoteza heap-ova (najvise zauzet / prosek) posle prve serije; od
+// --repeat ponavljanja uzima se najbrze. Redovi "+ hash" (Linux) vode zive
+// blokove i u hash mapi (HashMetadata) umesto samo u mapi stranica.
+// Kes niti je podrazumevano iskljucen (--thread-cache 0), jer inace skoro
+// nijedna alokacija ne zakljucava heap.
+namespace {
+struct Options {
+    size_t threads = 4;
+    size_t operations = 1000000;
+    size_t batch = 256;
+    size_t max_size = 1024;
+    size_t heap_count = 4;
+    size_t thread_cache_bytes = 0;
+    // Svako merenje se ponavlja i uzima se najkrace vreme.
+    size_t repeat = 3;
+};
+
+Options ParseArgs(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            options.threads = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--ops" && i + 1 < argc) {
+            options.operations = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--batch" && i + 1 < argc) {
+            options.batch = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--max-size" && i + 1 < argc) {
+            options.max_size = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--heaps" && i + 1 < argc) {
+            options.heap_count = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            options.repeat = std::max<size_t>(1, static_cast<size_t>(std::stoull(argv[++i])));
+        } else if (arg == "--thread-cache" && i + 1 < argc) {
+            options.thread_cache_bytes = static_cast<size_t>(std::stoull(argv[++i]));
+        }
+    }
+    return options;
+}
+
+struct Result {
+    double duration_ms = 0.0;
+    double imbalance = 0.0;
+};
+
+// Velicine i redosled oslobadjanja jedne niti, pripremljeni pre merenja.
+struct Workload {
+    std::vector<size_t> sizes;
+    std::vector<size_t> free_order;
+};
+
+Workload MakeWorkload(const Options& options, size_t seed) {
+    Workload workload;
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> exponent(4.0, std::log2(static_cast<double>(options.max_size)));
+    for (size_t i = 0; i < options.batch; ++i) {
+        workload.sizes.push_back(static_cast<size_t>(std::exp2(exponent(rng))));
+        workload.free_order.push_back(i);
+    }
+    std::shuffle(workload.free_order.begin(), workload.free_order.end(), rng);
+    return workload;
+}
+
+template <typename TManager>
+Result Run(const Options& options, size_t threads) {
+    typename TManager::Config config;
+    config.heap_count = options.heap_count;
+    config.thread_cache_bytes = options.thread_cache_bytes;
+    TManager ahm(config);
+
+    std::vector<Workload> workloads;
+    for (size_t t = 0; t < threads; ++t) {
+        workloads.push_back(MakeWorkload(options, t + 1));
+    }
+    const size_t rounds = std::max<size_t>(1, options.operations / options.batch);
+
+    std::atomic<size_t> allocated_threads{0};
+    std::atomic<bool> measured{false};
+    Result result;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            const Workload& workload = workloads[t];
+            std::vector<void*> blocks(options.batch);
+            for (size_t round = 0; round < rounds; ++round) {
+                for (size_t i = 0; i < options.batch; ++i) {
+                    blocks[i] = ahm.Malloc(workload.sizes[i]);
+                }
+                if (round == 0) {
+                    // Raspodela po heap-ovima dok su blokovi svih niti zivi.
+                    if (allocated_threads.fetch_add(1) + 1 == threads) {
+                        size_t total = 0;
+                        size_t maximum = 0;
+                        for (size_t i = 0; i < ahm.HeapCount(); ++i) {
+                            total += ahm.AllocatedBytes(i);
+                            maximum = std::max(maximum, ahm.AllocatedBytes(i));
+                        }
+                        if (total != 0) {
+                            result.imbalance = static_cast<double>(maximum) * ahm.HeapCount() / total;
+                        }
+                        measured.store(true);
+                    }
+                    while (!measured.load()) {
+                        std::this_thread::yield();
+                    }
+                }
+                for (size_t index : workload.free_order) {
+                    ahm.Free(blocks[index]);
+                }
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    result.duration_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+template <typename TManager>
+Result RunBest(const Options& options, size_t threads) {
+    Result best = Run<TManager>(options, threads);
+    for (size_t i = 1; i < options.repeat; ++i) {
+        Result result = Run<TManager>(options, threads);
+        if (result.duration_ms < best.duration_ms) {
+            best = result;
+        }
+    }
+    return best;
+}
+
+template <typename TLock, typename TBalance, typename TMetadata = PlatformMetadata>
+void Report(const Options& options, const char* name) {
+    Result single = RunBest<BasicHeapManager<TLock, TBalance, TMetadata>>(options, 1);
+    std::cout << std::left << std::setw(32) << name << std::right << std::setw(12) << single.duration_ms
+              << std::setw(10) << single.imbalance;
+    if (LockTraits<TLock>::kThreadSafe) {
+        Result multi = RunBest<BasicHeapManager<TLock, TBalance, TMetadata>>(options, options.threads);
+        std::cout << std::setw(12) << multi.duration_ms << std::setw(10) << multi.imbalance;
+    } else {
+        // Bez zakljucavanja menadzer sme da koristi samo jedna nit.
+        std::cout << std::setw(12) << "-" << std::setw(10) << "-";
+    }
+    std::cout << "\n";
+}
+}
+
+int main(int argc, char** argv) {
+    Options options = ParseArgs(argc, argv);
+
+    std::cout << "Operations per thread: " << options.operations << " (batch " << options.batch
+              << ", sizes 16.." << options.max_size << "), best of " << options.repeat << "\n";
+    std::cout << "Heaps: " << options.heap_count << ", thread cache bytes: " << options.thread_cache_bytes << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::left << std::setw(32) << "Policy" << std::right << std::setw(12) << "1 thr (ms)" << std::setw(10) << "max/avg"
+              << std::setw(9) << options.threads << " thr (ms)" << std::setw(10) << "max/avg" << "\n";
+
+    Report<std::mutex, LeastBytesBalance>(options, "mutex + least-bytes");
+    Report<std::mutex, RoundRobinBalance>(options, "mutex + round-robin");
+    Report<std::mutex, ThreadHashBalance>(options, "mutex + thread-hash");
+    Report<SpinLock, LeastBytesBalance>(options, "spinlock + least-bytes");
+    Report<SpinLock, RoundRobinBalance>(options, "spinlock + round-robin");
+    Report<SpinLock, ThreadHashBalance>(options, "spinlock + thread-hash");
+    Report<NullLock, LeastBytesBalance>(options, "no lock + least-bytes");
+    Report<NullLock, RoundRobinBalance>(options, "no lock + round-robin");
+    Report<NullLock, ThreadHashBalance>(options, "no lock + thread-hash");
+#ifndef _WIN32
+    // Zivi blokovi i u hash mapi (na Windows-u su to vec redovi iznad).
+    Report<std::mutex, LeastBytesBalance, HashMetadata>(options, "mutex + least-bytes + hash");
+    Report<SpinLock, LeastBytesBalance, HashMetadata>(options, "spinlock + least-bytes + hash");
+    Report<NullLock, LeastBytesBalance, HashMetadata>(options, "no lock + least-bytes + hash");
+#endif
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include "../../ahm/ahm.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+// Meri RSS procesa posle kratkog naleta alokacija: niti alociraju i popune
+// burst_bytes memorije u blokovima log-uniformne velicine, oslobode sve i
+// zavrse, a zatim se RSS ispisuje u pravilnim razmacima. Sa decay-om AHM
+// treba da vrati slobodne stranice OS-u, bez njega RSS ostaje na vrhu.
+// Pre naleta se --churn puta alocira i oslobodi blok od --churn-block
+// bajtova (podrazumevano veci od kesa velikih regiona, pa svaki put ide u
+// mmap/munmap); RSS posle toga ne sme da poraste za vise od 1 MiB, inace
+// program vraca 1.
+namespace {
+struct Options {
+    size_t threads = 1;
+    size_t burst_bytes = 1024ull * 1024ull * 1024ull;
+    size_t max_block = 256 * 1024;
+    size_t heap_count = 8;
+    size_t decay_ms = 1000;
+    size_t duration_ms = 5000;
+    size_t interval_ms = 500;
+    bool purge = false;
+    bool use_ahm = true;
+    size_t churn = 20000;
+    size_t churn_block = 64 * 1024 * 1024;
+};
+
+Options ParseArgs(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            options.threads = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--burst-bytes" && i + 1 < argc) {
+            options.burst_bytes = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--max-block" && i + 1 < argc) {
+            options.max_block = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--heaps" && i + 1 < argc) {
+            options.heap_count = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--decay" && i + 1 < argc) {
+            options.decay_ms = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--duration" && i + 1 < argc) {
+            options.duration_ms = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--interval" && i + 1 < argc) {
+            options.interval_ms = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--churn" && i + 1 < argc) {
+            options.churn = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--churn-block" && i + 1 < argc) {
+            options.churn_block = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--purge") {
+            options.purge = true;
+        } else if (arg == "--malloc") {
+            options.use_ahm = false;
+        }
+    }
+    return options;
+}
+
+// Rezidentna memorija procesa u bajtovima.
+size_t ResidentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.WorkingSetSize;
+#else
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    statm >> total_pages >> resident_pages;
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+double Mebibytes(size_t bytes) {
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+// Porast RSS-a posle churn ponavljanja Malloc/Free istog bloka (prvi par se
+// ne racuna, on mapira pocetne strukture).
+size_t ChurnGrowth(AdvancedHeapManager& ahm, const Options& options) {
+    size_t before = 0;
+    for (size_t i = 0; i <= options.churn; ++i) {
+        if (i == 1) {
+            before = ResidentBytes();
+        }
+        char* ptr = static_cast<char*>(options.use_ahm ? ahm.Malloc(options.churn_block) : std::malloc(options.churn_block));
+        if (!ptr) {
+            break;
+        }
+        ptr[0] = 1;
+        if (options.use_ahm) {
+            ahm.Free(ptr);
+        } else {
+            std::free(ptr);
+        }
+    }
+    size_t after = ResidentBytes();
+    return after > before ? after - before : 0;
+}
+}
+
+int main(int argc, char** argv) {
+    Options options = ParseArgs(argc, argv);
+    AdvancedHeapManager::Config config;
+    config.heap_count = options.heap_count;
+    config.purge_decay_ms = options.decay_ms;
+    AdvancedHeapManager ahm(config);
+
+    std::cout << "Threads: " << options.threads << "\n";
+    std::cout << "Burst bytes: " << options.burst_bytes << "\n";
+    std::cout << "Max block: " << options.max_block << "\n";
+    std::cout << "Allocator: " << (options.use_ahm ? "AHM" : "malloc/free") << "\n";
+    if (options.use_ahm) {
+        std::cout << "Decay (ms): " << options.decay_ms << "\n";
+    }
+    bool churn_flat = true;
+    if (options.churn > 0) {
+        size_t growth = ChurnGrowth(ahm, options);
+        churn_flat = growth <= 1024 * 1024;
+        std::cout << "Churn: " << options.churn << " x " << options.churn_block << " B, RSS growth (MiB): "
+                  << Mebibytes(growth) << (churn_flat ? "" : " (RSS raste)") << "\n";
+    }
+    std::cout << "RSS before burst (MiB): " << Mebibytes(ResidentBytes()) << "\n";
+
+    const size_t bytes_per_thread = options.burst_bytes / options.threads;
+    std::vector<size_t> peaks(options.threads, 0);
+    std::thread* workers = new std::thread[options.threads];
+    for (size_t t = 0; t < options.threads; ++t) {
+        workers[t] = std::thread([&, t]() {
+            std::mt19937_64 rng(t + 1);
+            std::uniform_real_distribution<double> exponent(4.0, std::log2(static_cast<double>(options.max_block)));
+            std::vector<void*> blocks;
+            size_t allocated = 0;
+            while (allocated < bytes_per_thread) {
+                size_t size = static_cast<size_t>(std::exp2(exponent(rng)));
+                void* ptr = options.use_ahm ? ahm.Malloc(size) : std::malloc(size);
+                if (!ptr) {
+                    break;
+                }
+                std::memset(ptr, 1, size);
+                blocks.push_back(ptr);
+                allocated += size;
+            }
+            peaks[t] = ResidentBytes();
+            for (void* ptr : blocks) {
+                if (options.use_ahm) {
+                    ahm.Free(ptr);
+                } else {
+                    std::free(ptr);
+                }
+            }
+        });
+    }
+    for (size_t t = 0; t < options.threads; ++t) {
+        workers[t].join();
+    }
+    delete[] workers;
+
+    size_t peak = 0;
+    for (size_t bytes : peaks) {
+        peak = bytes > peak ? bytes : peak;
+    }
+    std::cout << "RSS at peak (MiB): " << Mebibytes(peak) << "\n";
+
+    auto start = std::chrono::steady_clock::now();
+    if (options.use_ahm && options.purge) {
+        size_t released = ahm.Purge();
+        auto purge_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Purge: " << Mebibytes(released) << " MiB in " << purge_ms << " ms\n";
+    }
+
+    std::cout << "Time (ms)\tRSS (MiB)\n";
+    for (size_t elapsed = 0; elapsed <= options.duration_ms; elapsed += options.interval_ms) {
+        std::this_thread::sleep_until(start + std::chrono::milliseconds(elapsed));
+        std::cout << elapsed << "\t" << Mebibytes(ResidentBytes()) << "\n";
+    }
+
+    return churn_flat ? 0 : 1;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#ifndef _WIN32
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Minimalan io_uring prsten nad sirovim sistemskim pozivima (bez liburing-a):
+// mapira SQ/CQ prstenove, daje slobodne SQE-ove i cita CQE-ove. Koristi ga
+// samo jedna nit (IORING_SETUP_SINGLE_ISSUER kada ga kernel podrzava).
+class IoUringRing {
+public:
+    IoUringRing(unsigned entries, unsigned cq_entries) {
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+        params.cq_entries = cq_entries;
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd_ < 0) {
+            // Stariji kernel: bez SINGLE_ISSUER/DEFER_TASKRUN (dodati u 6.0/6.1).
+            std::memset(&params, 0, sizeof(params));
+            params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL;
+            params.cq_entries = cq_entries;
+            fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        }
+        if (fd_ < 0) {
+            throw std::runtime_error("io_uring_setup failed");
+        }
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+            close(fd_);
+            throw std::runtime_error("io_uring kernel is too old");
+        }
+
+        // SQ i CQ prsten dele jedno mapiranje (IORING_FEAT_SINGLE_MMAP).
+        size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        ring_size_ = sq_size > cq_size ? sq_size : cq_size;
+        ring_ = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+        if (ring_ == MAP_FAILED) {
+            close(fd_);
+            throw std::runtime_error("io_uring ring mmap failed");
+        }
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            munmap(ring_, ring_size_);
+            close(fd_);
+            throw std::runtime_error("io_uring sqe mmap failed");
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        char* base = static_cast<char*>(ring_);
+        sq_head_ = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+        sq_entries_ = params.sq_entries;
+        cq_head_ = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+
+        // Niz indeksa SQ prstena je identitet, pa se popunjava jednom.
+        unsigned* array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+        for (unsigned i = 0; i < params.sq_entries; ++i) {
+            array[i] = i;
+        }
+        sqe_tail_ = *sq_tail_;
+    }
+
+    ~IoUringRing() {
+        munmap(sqes_, sqes_size_);
+        munmap(ring_, ring_size_);
+        close(fd_);
+    }
+
+    IoUringRing(const IoUringRing&) = delete;
+    IoUringRing& operator=(const IoUringRing&) = delete;
+
+    // Sledeci slobodan SQE (obrisan); ako je SQ pun, prvo se salju pripremljeni.
+    io_uring_sqe* GetSqe() {
+        unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (sqe_tail_ - head >= sq_entries_) {
+            Submit(0, 0);
+            head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+            if (sqe_tail_ - head >= sq_entries_) {
+                return nullptr;
+            }
+        }
+        io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+        ++sqe_tail_;
+        std::memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    // Obezbedjuje count slobodnih SQE-ova (npr. za povezani lanac, koji ne sme
+    // da se podeli izmedju dva slanja). Vraca false ako ni posle slanja nema mesta.
+    bool EnsureSqes(unsigned count) {
+        if (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) + count <= sq_entries_) {
+            return true;
+        }
+        Submit(0, 0);
+        return sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) + count <= sq_entries_;
+    }
+
+    // Salje pripremljene SQE-ove i ceka bar wait_count CQE-ova, najvise
+    // timeout_ms (jedan io_uring_enter). Vraca rezultat sistemskog poziva.
+    int Submit(unsigned wait_count, long timeout_ms) {
+        unsigned to_submit = sqe_tail_ - *sq_tail_;
+        __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+
+        unsigned flags = IORING_ENTER_EXT_ARG;
+        __kernel_timespec timeout{};
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_nsec = (timeout_ms % 1000) * 1000000;
+        io_uring_getevents_arg arg{};
+        if (wait_count > 0) {
+            flags |= IORING_ENTER_GETEVENTS;
+            arg.ts = reinterpret_cast<uint64_t>(&timeout);
+        }
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd_, to_submit, wait_count, flags, &arg, sizeof(arg)));
+    }
+
+    // Sledeci CQE ili nullptr; posle obrade obavezno CqeSeen().
+    io_uring_cqe* PeekCqe() {
+        unsigned head = *cq_head_;
+        if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            return nullptr;
+        }
+        return &cqes_[head & cq_mask_];
+    }
+
+    void CqeSeen() {
+        __atomic_store_n(cq_head_, *cq_head_ + 1, __ATOMIC_RELEASE);
+    }
+
+    int Register(unsigned opcode, const void* arg, unsigned count) {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd_, opcode, arg, count));
+    }
+
+private:
+    int fd_;
+    void* ring_;
+    size_t ring_size_;
+    io_uring_sqe* sqes_;
+    size_t sqes_size_;
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned sq_mask_;
+    unsigned sq_entries_;
+    // Lokalni rep SQ-a: SQE-ovi do njega su pripremljeni, a kernel ih vidi tek u Submit.
+    unsigned sqe_tail_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned cq_mask_;
+    io_uring_cqe* cqes_;
+};
+
+#endif
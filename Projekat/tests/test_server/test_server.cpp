@@ -2,12 +2,17 @@
 #define _WINSOCK_DEPRECATED_NO_WARNINGS
 
 #include "../../ahm/ahm.h"
+#include "../../ahm/ahm_arena.h"
+#ifndef _WIN32
+#include "io_uring_ring.h"
+#endif
 
 #include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <mutex>
 #include <random>
 #include <string>
 #include <thread>
@@ -20,6 +25,17 @@
 #pragma comment(lib, "Ws2_32.lib")
 #pragma comment(lib, "Mswsock.lib")
 #pragma comment(lib, "AdvApi32.lib")
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
 #endif
 
 namespace {
@@ -27,6 +43,14 @@ struct Options {
     uint16_t port = 4000;
     size_t max_message = 64 * 1024;
     bool use_ahm = true;
+    // Baferi poruke iz arene konekcije, oslobodjeni jednim Reset-om po poruci.
+    bool use_arena = false;
+    // Broj radnih niti epoll petlje (samo Linux); svaka ima svoj heap.
+    size_t workers = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 4;
+    // io_uring umesto epoll-a (samo Linux); baferi su unapred uzeti iz AHM-a.
+    bool use_uring = false;
+    // Bajtova po heap-u koji se pre prvog zahteva ucitaju u memoriju (WarmUp).
+    size_t warm_up = 0;
 };
 
 // Jednostavna dinamicka lista niti bez STL kontejnera.
@@ -77,8 +101,18 @@ Options ParseArgs(int argc, char** argv) {
             options.port = static_cast<uint16_t>(std::stoi(argv[++i]));
         } else if (arg == "--max-message" && i + 1 < argc) {
             options.max_message = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--workers" && i + 1 < argc) {
+            options.workers = static_cast<size_t>(std::stoull(argv[++i]));
         } else if (arg == "--malloc") {
             options.use_ahm = false;
+            options.use_arena = false;
+        } else if (arg == "--warm-up" && i + 1 < argc) {
+            options.warm_up = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--uring") {
+            options.use_uring = true;
+        } else if (arg == "--arena") {
+            options.use_ahm = true;
+            options.use_arena = true;
         }
     }
     return options;
@@ -112,6 +146,729 @@ bool SendAll(SOCKET socket, const void* buffer, size_t size) {
     }
     return true;
 }
+#else
+// Linux: fiksan broj radnih niti, svaka sa svojim epoll-om i heap-om AHM-a.
+// Glavna nit prihvata konekcije i redom ih deli radnicima; soketi su
+// neblokirajuci, pa jedna nit opsluzuje hiljade konekcija.
+
+std::atomic<bool> g_running{true};
+
+void StopServer(int) {
+    g_running.store(false);
+}
+
+// Stanje konekcije: zaglavlje (duzina) -> telo poruke -> odgovor.
+struct Connection {
+    enum class State { kHeader, kBody, kResponse };
+
+    Connection(AdvancedHeapManager& ahm, size_t heap_index, int socket_fd, size_t arena_chunk)
+        : socket(socket_fd), arena(ahm, heap_index, arena_chunk), start(std::chrono::steady_clock::now()) {}
+
+    // Lista otvorenih konekcija radnika (za gasenje).
+    Connection* next = nullptr;
+    Connection* prev = nullptr;
+    int socket;
+    State state = State::kHeader;
+    // Da li je soket prijavljen za EPOLLOUT (odgovor nije stao u bafer soketa).
+    bool waiting_write = false;
+
+    uint32_t length = 0;
+    void* recv_buffer = nullptr;
+    size_t recv_size = 0;
+    // Primljeni bajtovi tekuceg dela (zaglavlja ili tela).
+    size_t received = 0;
+
+    uint32_t response_length = 0;
+    void* send_buffer = nullptr;
+    size_t send_size = 0;
+    // Poslati bajtovi odgovora, racunajuci i 4 bajta duzine.
+    size_t sent = 0;
+
+    // Arena se koristi samo sa --arena; bez prvog Allocate ne uzima memoriju.
+    AhmArena arena;
+    size_t messages = 0;
+    size_t bytes = 0;
+    std::chrono::steady_clock::time_point start;
+};
+
+struct Worker {
+    size_t heap_index = 0;
+    int epoll_fd = -1;
+    // Konekcije dodaje glavna nit, a uklanja radnik, pa je lista pod mutex-om.
+    std::mutex mutex;
+    Connection* connections = nullptr;
+    // Radnik je zatvorio svoje konekcije i ne prima nove.
+    bool stopped = false;
+    std::mt19937 rng;
+    std::uniform_int_distribution<size_t> response_sizes;
+};
+
+class EpollServer {
+public:
+    EpollServer(AdvancedHeapManager& ahm, const Options& options, std::atomic<size_t>& total_messages, std::atomic<size_t>& total_bytes)
+        : ahm_(ahm), options_(options), total_messages_(total_messages), total_bytes_(total_bytes) {}
+
+    void Run(Worker& worker) {
+        const int kMaxEvents = 256;
+        epoll_event events[kMaxEvents];
+        while (g_running.load(std::memory_order_relaxed)) {
+            // Kratak timeout da bi nit primetila gasenje servera.
+            int count = epoll_wait(worker.epoll_fd, events, kMaxEvents, 100);
+            for (int i = 0; i < count; ++i) {
+                Connection* connection = static_cast<Connection*>(events[i].data.ptr);
+                if (!Progress(worker, connection)) {
+                    Close(worker, connection);
+                }
+            }
+        }
+        // Gasenje: konekcije koje su jos otvorene se zatvaraju i broje.
+        while (true) {
+            Connection* connection = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                if (!worker.connections) {
+                    worker.stopped = true;
+                    return;
+                }
+                connection = worker.connections;
+            }
+            Close(worker, connection);
+        }
+    }
+
+    // Predaje konekciju radniku; false ako se radnik vec ugasio ili epoll_ctl
+    // ne uspe (konekciju tada zatvara pozivalac).
+    bool Add(Worker& worker, Connection* connection) {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.stopped) {
+            return false;
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = connection;
+        if (epoll_ctl(worker.epoll_fd, EPOLL_CTL_ADD, connection->socket, &event) != 0) {
+            return false;
+        }
+        connection->next = worker.connections;
+        if (worker.connections) {
+            worker.connections->prev = connection;
+        }
+        worker.connections = connection;
+        return true;
+    }
+
+private:
+    void* Allocate(Worker& worker, Connection* connection, size_t size) {
+        if (options_.use_arena) {
+            return connection->arena.Allocate(size);
+        }
+        return options_.use_ahm ? ahm_.MallocOnHeap(worker.heap_index, size) : std::malloc(size);
+    }
+
+    // Sa arenom se baferi ne oslobadjaju pojedinacno (vidi arena.Reset()).
+    void Release(Worker& worker, void* ptr) {
+        if (!ptr || options_.use_arena) {
+            return;
+        }
+        if (options_.use_ahm) {
+            ahm_.FreeHinted(ptr, worker.heap_index);
+        } else {
+            std::free(ptr);
+        }
+    }
+
+    // Cita i pise dok soket ne bi blokirao; false znaci da konekciju treba zatvoriti.
+    bool Progress(Worker& worker, Connection* connection) {
+        while (true) {
+            if (connection->state == Connection::State::kHeader) {
+                char* header = reinterpret_cast<char*>(&connection->length);
+                ssize_t result = recv(connection->socket, header + connection->received, sizeof(connection->length) - connection->received, 0);
+                if (result <= 0) {
+                    return result < 0 && errno == EAGAIN;
+                }
+                connection->received += static_cast<size_t>(result);
+                if (connection->received < sizeof(connection->length)) {
+                    continue;
+                }
+                // Primi poruku.
+                connection->recv_size = ntohl(connection->length);
+                connection->recv_buffer = Allocate(worker, connection, connection->recv_size);
+                if (!connection->recv_buffer) {
+                    return false;
+                }
+                connection->received = 0;
+                connection->state = Connection::State::kBody;
+            } else if (connection->state == Connection::State::kBody) {
+                if (connection->received < connection->recv_size) {
+                    char* body = static_cast<char*>(connection->recv_buffer);
+                    ssize_t result = recv(connection->socket, body + connection->received, connection->recv_size - connection->received, 0);
+                    if (result <= 0) {
+                        return result < 0 && errno == EAGAIN;
+                    }
+                    connection->received += static_cast<size_t>(result);
+                    continue;
+                }
+                ++connection->messages;
+                connection->bytes += connection->recv_size;
+
+                // Pripremi odgovor nasumicne duzine.
+                connection->send_size = worker.response_sizes(worker.rng);
+                connection->send_buffer = Allocate(worker, connection, connection->send_size);
+                if (!connection->send_buffer) {
+                    return false;
+                }
+                std::memset(connection->send_buffer, 0xA5, connection->send_size);
+                connection->response_length = htonl(static_cast<uint32_t>(connection->send_size));
+                connection->sent = 0;
+                connection->state = Connection::State::kResponse;
+            } else {
+                // Duzina i telo odgovora jednim sistemskim pozivom.
+                const size_t header_size = sizeof(connection->response_length);
+                iovec parts[2];
+                size_t part_count = 0;
+                if (connection->sent < header_size) {
+                    parts[part_count].iov_base = reinterpret_cast<char*>(&connection->response_length) + connection->sent;
+                    parts[part_count].iov_len = header_size - connection->sent;
+                    ++part_count;
+                }
+                size_t body_sent = connection->sent > header_size ? connection->sent - header_size : 0;
+                parts[part_count].iov_base = static_cast<char*>(connection->send_buffer) + body_sent;
+                parts[part_count].iov_len = connection->send_size - body_sent;
+                ++part_count;
+
+                msghdr message{};
+                message.msg_iov = parts;
+                message.msg_iovlen = part_count;
+                ssize_t result = sendmsg(connection->socket, &message, MSG_NOSIGNAL);
+                if (result < 0) {
+                    if (errno != EAGAIN) {
+                        return false;
+                    }
+                    return SetWaitingWrite(worker, connection, true);
+                }
+                connection->sent += static_cast<size_t>(result);
+                if (connection->sent < header_size + connection->send_size) {
+                    continue;
+                }
+                ++connection->messages;
+                connection->bytes += connection->send_size;
+
+                Release(worker, connection->send_buffer);
+                Release(worker, connection->recv_buffer);
+                connection->send_buffer = nullptr;
+                connection->recv_buffer = nullptr;
+                if (options_.use_arena) {
+                    connection->arena.Reset();
+                }
+                connection->received = 0;
+                connection->state = Connection::State::kHeader;
+                if (!SetWaitingWrite(worker, connection, false)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Soket ceka EPOLLOUT samo dok odgovor ne stane u bafer soketa.
+    bool SetWaitingWrite(Worker& worker, Connection* connection, bool waiting) {
+        if (connection->waiting_write == waiting) {
+            return true;
+        }
+        epoll_event event{};
+        event.events = waiting ? EPOLLOUT : EPOLLIN;
+        event.data.ptr = connection;
+        if (epoll_ctl(worker.epoll_fd, EPOLL_CTL_MOD, connection->socket, &event) != 0) {
+            return false;
+        }
+        connection->waiting_write = waiting;
+        return true;
+    }
+
+    void Close(Worker& worker, Connection* connection) {
+        auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - connection->start);
+        total_messages_.fetch_add(connection->messages, std::memory_order_relaxed);
+        total_bytes_.fetch_add(connection->bytes, std::memory_order_relaxed);
+        std::cout << "Klijent zavrsio: poruke=" << connection->messages
+            << " bajtova=" << connection->bytes
+            << " vreme(ms)=" << elapsed_ms.count() << "\n";
+
+        Release(worker, connection->send_buffer);
+        Release(worker, connection->recv_buffer);
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if (connection->prev) {
+                connection->prev->next = connection->next;
+            } else {
+                worker.connections = connection->next;
+            }
+            if (connection->next) {
+                connection->next->prev = connection->prev;
+            }
+        }
+        // close uklanja soket i iz epoll skupa.
+        close(connection->socket);
+        delete connection;
+    }
+
+    AdvancedHeapManager& ahm_;
+    const Options& options_;
+    std::atomic<size_t>& total_messages_;
+    std::atomic<size_t>& total_bytes_;
+};
+
+// io_uring nacin (--uring): radnik ima svoj prsten i sam prihvata konekcije
+// (multishot accept na zajednickom soketu). Prijem ide kroz multishot recv
+// u prsten obezbedjenih bafera, a odgovor (duzina + telo) kao dva povezana
+// SQE-a iz registrovanih (fixed) bafera. Svi baferi su uzeti iz heap-a
+// radnika jednom, pa poruka ne trazi ni alokaciju ni poseban sistemski poziv.
+struct UringConnection {
+    explicit UringConnection(int socket_fd) : socket(socket_fd), start(std::chrono::steady_clock::now()) {}
+
+    // Lista otvorenih konekcija radnika (za gasenje).
+    UringConnection* next = nullptr;
+    UringConnection* prev = nullptr;
+    int socket;
+
+    // Prijem: duzina poruke se sklapa bajt po bajt, telo se samo preskace.
+    uint32_t length = 0;
+    size_t header_received = 0;
+    size_t body_remaining = 0;
+    size_t recv_size = 0;
+    // Primljene poruke koje jos cekaju odgovor (klijent moze da salje unapred).
+    size_t pending_responses = 0;
+
+    // Odgovor u letu: slot bafera odgovora ili (kada ih nema) blok iz heap-a.
+    bool sending = false;
+    uint32_t response_length = 0;
+    char* response = nullptr;
+    int response_slot = -1;
+    size_t response_size = 0;
+    size_t header_sent = 0;
+    size_t payload_sent = 0;
+    int sends_in_flight = 0;
+    bool send_failed = false;
+
+    bool recv_armed = false;
+    bool closing = false;
+    size_t messages = 0;
+    size_t bytes = 0;
+    std::chrono::steady_clock::time_point start;
+};
+
+class UringWorker {
+public:
+    UringWorker(AdvancedHeapManager& ahm, const Options& options, size_t heap_index, int listen_socket,
+        std::atomic<size_t>& total_messages, std::atomic<size_t>& total_bytes)
+        : ring_(kRingEntries, kCompletionEntries),
+          ahm_(ahm),
+          heap_index_(heap_index),
+          listen_socket_(listen_socket),
+          total_messages_(total_messages),
+          total_bytes_(total_bytes),
+          rng_(static_cast<unsigned int>(heap_index + 1)),
+          response_sizes_(1, options.max_message),
+          // Slot je poravnat na liniju kesa.
+          slot_size_((options.max_message + 63) & ~static_cast<size_t>(63)) {
+        // Prsten obezbedjenih bafera: niz opisa (poravnat na stranicu) i sami baferi.
+        buffer_ring_ = static_cast<io_uring_buf_ring*>(ahm_.MallocAligned(kRecvBufferCount * sizeof(io_uring_buf), 4096));
+        recv_buffers_ = static_cast<char*>(ahm_.MallocOnHeap(heap_index_, kRecvBufferCount * kRecvBufferSize));
+        // Baferi odgovora: jedan blok registrovan kao fixed bafer 0, podeljen na slotove.
+        responses_ = static_cast<char*>(ahm_.MallocOnHeap(heap_index_, kResponseSlots * slot_size_));
+        if (!buffer_ring_ || !recv_buffers_ || !responses_) {
+            FreeBuffers();
+            throw std::runtime_error("AHM allocation of io_uring buffers failed");
+        }
+        std::memset(buffer_ring_, 0, kRecvBufferCount * sizeof(io_uring_buf));
+
+        io_uring_buf_reg buffer_ring_reg{};
+        buffer_ring_reg.ring_addr = reinterpret_cast<uint64_t>(buffer_ring_);
+        buffer_ring_reg.ring_entries = kRecvBufferCount;
+        buffer_ring_reg.bgid = kBufferGroup;
+        if (ring_.Register(IORING_REGISTER_PBUF_RING, &buffer_ring_reg, 1) != 0) {
+            FreeBuffers();
+            throw std::runtime_error("IORING_REGISTER_PBUF_RING failed");
+        }
+        iovec fixed{};
+        fixed.iov_base = responses_;
+        fixed.iov_len = kResponseSlots * slot_size_;
+        if (ring_.Register(IORING_REGISTER_BUFFERS, &fixed, 1) != 0) {
+            ring_.Register(IORING_UNREGISTER_PBUF_RING, &buffer_ring_reg, 1);
+            FreeBuffers();
+            throw std::runtime_error("IORING_REGISTER_BUFFERS failed (RLIMIT_MEMLOCK?)");
+        }
+
+        for (unsigned i = 0; i < kRecvBufferCount; ++i) {
+            RecycleBuffer(static_cast<uint16_t>(i));
+        }
+        for (int i = 0; i < static_cast<int>(kResponseSlots); ++i) {
+            free_slots_[i] = i;
+        }
+        free_slot_count_ = kResponseSlots;
+    }
+
+    ~UringWorker() {
+        io_uring_buf_reg buffer_ring_reg{};
+        buffer_ring_reg.bgid = kBufferGroup;
+        ring_.Register(IORING_UNREGISTER_PBUF_RING, &buffer_ring_reg, 1);
+        ring_.Register(IORING_UNREGISTER_BUFFERS, nullptr, 0);
+        FreeBuffers();
+    }
+
+    UringWorker(const UringWorker&) = delete;
+    UringWorker& operator=(const UringWorker&) = delete;
+
+    void Run() {
+        ArmAccept();
+        bool stopping = false;
+        while (!stopping || connections_) {
+            if (!stopping && !g_running.load(std::memory_order_relaxed)) {
+                // Gasenje: zatvori sve konekcije i sacekaj da se njihove operacije zavrse.
+                stopping = true;
+                stopping_ = true;
+                UringConnection* connection = connections_;
+                while (connection) {
+                    UringConnection* next = connection->next;
+                    BeginClose(connection);
+                    MaybeFinalize(connection);
+                    connection = next;
+                }
+                continue;
+            }
+            // Jedan sistemski poziv salje sve pripremljeno i ceka nove dogadjaje.
+            ring_.Submit(1, 100);
+            while (io_uring_cqe* cqe = ring_.PeekCqe()) {
+                uint64_t user_data = cqe->user_data;
+                int result = cqe->res;
+                unsigned flags = cqe->flags;
+                ring_.CqeSeen();
+                UringConnection* connection = reinterpret_cast<UringConnection*>(user_data & ~kOpMask);
+                switch (user_data & kOpMask) {
+                case kOpAccept:
+                    OnAccept(result, flags);
+                    break;
+                case kOpRecv:
+                    OnRecv(connection, result, flags);
+                    break;
+                default:
+                    OnSend(connection, user_data & kOpMask, result);
+                    break;
+                }
+            }
+        }
+    }
+
+private:
+    static const unsigned kRingEntries = 4096;
+    static const unsigned kCompletionEntries = 16384;
+    static const unsigned kRecvBufferCount = 512;
+    static const size_t kRecvBufferSize = 16 * 1024;
+    static const uint16_t kBufferGroup = 0;
+    static const size_t kResponseSlots = 64;
+
+    // Vrsta operacije u najnizim bitima user_data (konekcija je poravnata na 8).
+    static const uint64_t kOpAccept = 0;
+    static const uint64_t kOpRecv = 1;
+    static const uint64_t kOpHeader = 2;
+    static const uint64_t kOpPayload = 3;
+    static const uint64_t kOpMask = 3;
+
+    static uint64_t UserData(UringConnection* connection, uint64_t op) {
+        return reinterpret_cast<uint64_t>(connection) | op;
+    }
+
+    void FreeBuffers() {
+        ahm_.Free(buffer_ring_);
+        ahm_.FreeHinted(recv_buffers_, heap_index_);
+        ahm_.FreeHinted(responses_, heap_index_);
+        buffer_ring_ = nullptr;
+        recv_buffers_ = nullptr;
+        responses_ = nullptr;
+    }
+
+    // Vraca bafer u prsten obezbedjenih bafera (kernel ga vidi posle pomeranja repa).
+    // Prsten je niz io_uring_buf (rep je u rezervisanom polju prvog); clan bufs
+    // se ne koristi jer je u C++-u zbog __DECLARE_FLEX_ARRAY pomeren za 8 bajtova.
+    void RecycleBuffer(uint16_t buffer_id) {
+        io_uring_buf* buffer = reinterpret_cast<io_uring_buf*>(buffer_ring_) + (buffer_ring_tail_ & (kRecvBufferCount - 1));
+        buffer->addr = reinterpret_cast<uint64_t>(recv_buffers_ + buffer_id * kRecvBufferSize);
+        buffer->len = static_cast<uint32_t>(kRecvBufferSize);
+        buffer->bid = buffer_id;
+        ++buffer_ring_tail_;
+        __atomic_store_n(&buffer_ring_->tail, buffer_ring_tail_, __ATOMIC_RELEASE);
+    }
+
+    void ArmAccept() {
+        io_uring_sqe* sqe = ring_.GetSqe();
+        if (!sqe) {
+            return;
+        }
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = listen_socket_;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->user_data = UserData(nullptr, kOpAccept);
+    }
+
+    bool ArmRecv(UringConnection* connection) {
+        io_uring_sqe* sqe = ring_.GetSqe();
+        if (!sqe) {
+            return false;
+        }
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = connection->socket;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = kBufferGroup;
+        sqe->user_data = UserData(connection, kOpRecv);
+        connection->recv_armed = true;
+        return true;
+    }
+
+    void OnAccept(int result, unsigned flags) {
+        if (!(flags & IORING_CQE_F_MORE) && !stopping_) {
+            ArmAccept();
+        }
+        if (result < 0) {
+            return;
+        }
+        if (stopping_) {
+            close(result);
+            return;
+        }
+        int no_delay = 1;
+        setsockopt(result, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+        UringConnection* connection = new UringConnection(result);
+        connection->next = connections_;
+        if (connections_) {
+            connections_->prev = connection;
+        }
+        connections_ = connection;
+        if (!ArmRecv(connection)) {
+            BeginClose(connection);
+            MaybeFinalize(connection);
+        }
+    }
+
+    void OnRecv(UringConnection* connection, int result, unsigned flags) {
+        if (flags & IORING_CQE_F_BUFFER) {
+            uint16_t buffer_id = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+            if (result > 0 && !connection->closing) {
+                Consume(connection, recv_buffers_ + buffer_id * kRecvBufferSize, static_cast<size_t>(result));
+            }
+            // Telo poruke se ne cuva, pa se bafer vraca odmah.
+            RecycleBuffer(buffer_id);
+        }
+        if (!(flags & IORING_CQE_F_MORE)) {
+            // Multishot recv je zavrsen: kraj veze, greska ili (npr. bez
+            // slobodnih bafera) privremeni prekid posle koga se ponovo pokrece.
+            connection->recv_armed = false;
+            bool rearm = !connection->closing && (result > 0 || result == -ENOBUFS);
+            if (!rearm || !ArmRecv(connection)) {
+                BeginClose(connection);
+            }
+        }
+        MaybeFinalize(connection);
+    }
+
+    void Consume(UringConnection* connection, const char* data, size_t size) {
+        while (size > 0) {
+            if (connection->header_received < sizeof(connection->length)) {
+                size_t count = sizeof(connection->length) - connection->header_received;
+                count = count < size ? count : size;
+                std::memcpy(reinterpret_cast<char*>(&connection->length) + connection->header_received, data, count);
+                connection->header_received += count;
+                data += count;
+                size -= count;
+                if (connection->header_received < sizeof(connection->length)) {
+                    break;
+                }
+                connection->recv_size = ntohl(connection->length);
+                connection->body_remaining = connection->recv_size;
+            } else {
+                size_t count = connection->body_remaining < size ? connection->body_remaining : size;
+                connection->body_remaining -= count;
+                data += count;
+                size -= count;
+            }
+            if (connection->body_remaining == 0) {
+                ++connection->messages;
+                connection->bytes += connection->recv_size;
+                connection->header_received = 0;
+                ++connection->pending_responses;
+            }
+        }
+        if (!connection->sending && connection->pending_responses > 0) {
+            StartResponse(connection);
+        }
+    }
+
+    void StartResponse(UringConnection* connection) {
+        --connection->pending_responses;
+        // Pripremi odgovor nasumicne duzine.
+        connection->response_size = response_sizes_(rng_);
+        if (free_slot_count_ > 0) {
+            connection->response_slot = free_slots_[--free_slot_count_];
+            connection->response = responses_ + static_cast<size_t>(connection->response_slot) * slot_size_;
+        } else {
+            connection->response_slot = -1;
+            connection->response = static_cast<char*>(ahm_.MallocOnHeap(heap_index_, connection->response_size));
+            if (!connection->response) {
+                BeginClose(connection);
+                return;
+            }
+        }
+        std::memset(connection->response, 0xA5, connection->response_size);
+        connection->response_length = htonl(static_cast<uint32_t>(connection->response_size));
+        connection->header_sent = 0;
+        connection->payload_sent = 0;
+        connection->send_failed = false;
+        connection->sending = true;
+        SubmitResponse(connection);
+    }
+
+    // Duzina (SEND) i telo (WRITE_FIXED iz slota) kao povezan lanac: telo se
+    // salje tek kada je duzina poslata cela. Posle kratkog slanja salje se ostatak.
+    void SubmitResponse(UringConnection* connection) {
+        const size_t header_size = sizeof(connection->response_length);
+        if (!ring_.EnsureSqes(2)) {
+            BeginClose(connection);
+            return;
+        }
+        if (connection->header_sent < header_size) {
+            io_uring_sqe* sqe = ring_.GetSqe();
+            sqe->opcode = IORING_OP_SEND;
+            sqe->fd = connection->socket;
+            sqe->addr = reinterpret_cast<uint64_t>(reinterpret_cast<char*>(&connection->response_length) + connection->header_sent);
+            sqe->len = static_cast<uint32_t>(header_size - connection->header_sent);
+            sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+            sqe->flags = IOSQE_IO_LINK;
+            sqe->user_data = UserData(connection, kOpHeader);
+            ++connection->sends_in_flight;
+        }
+        io_uring_sqe* sqe = ring_.GetSqe();
+        sqe->fd = connection->socket;
+        sqe->addr = reinterpret_cast<uint64_t>(connection->response + connection->payload_sent);
+        sqe->len = static_cast<uint32_t>(connection->response_size - connection->payload_sent);
+        if (connection->response_slot >= 0) {
+            sqe->opcode = IORING_OP_WRITE_FIXED;
+            sqe->buf_index = 0;
+        } else {
+            sqe->opcode = IORING_OP_SEND;
+            sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+        }
+        sqe->user_data = UserData(connection, kOpPayload);
+        ++connection->sends_in_flight;
+    }
+
+    void OnSend(UringConnection* connection, uint64_t op, int result) {
+        --connection->sends_in_flight;
+        if (result > 0) {
+            (op == kOpHeader ? connection->header_sent : connection->payload_sent) += static_cast<size_t>(result);
+        } else if (result != -ECANCELED) {
+            // -ECANCELED dobija telo kada duzina nije poslata cela; to se ponavlja.
+            connection->send_failed = true;
+        }
+        if (connection->sends_in_flight > 0) {
+            return;
+        }
+
+        if (connection->send_failed || connection->closing) {
+            BeginClose(connection);
+            MaybeFinalize(connection);
+            return;
+        }
+        if (connection->header_sent < sizeof(connection->response_length) ||
+            connection->payload_sent < connection->response_size) {
+            SubmitResponse(connection);
+            MaybeFinalize(connection);
+            return;
+        }
+
+        ++connection->messages;
+        connection->bytes += connection->response_size;
+        ReleaseResponse(connection);
+        if (connection->pending_responses > 0) {
+            StartResponse(connection);
+        }
+        MaybeFinalize(connection);
+    }
+
+    void ReleaseResponse(UringConnection* connection) {
+        if (!connection->sending) {
+            return;
+        }
+        if (connection->response_slot >= 0) {
+            free_slots_[free_slot_count_++] = connection->response_slot;
+        } else {
+            ahm_.FreeHinted(connection->response, heap_index_);
+        }
+        connection->response = nullptr;
+        connection->response_slot = -1;
+        connection->sending = false;
+    }
+
+    // shutdown prekida recv i slanja u letu; konekcija se brise kada se sve vrate.
+    void BeginClose(UringConnection* connection) {
+        if (connection->closing) {
+            return;
+        }
+        connection->closing = true;
+        shutdown(connection->socket, SHUT_RDWR);
+    }
+
+    void MaybeFinalize(UringConnection* connection) {
+        if (!connection->closing || connection->recv_armed || connection->sends_in_flight > 0) {
+            return;
+        }
+        auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - connection->start);
+        total_messages_.fetch_add(connection->messages, std::memory_order_relaxed);
+        total_bytes_.fetch_add(connection->bytes, std::memory_order_relaxed);
+        std::cout << "Klijent zavrsio: poruke=" << connection->messages
+            << " bajtova=" << connection->bytes
+            << " vreme(ms)=" << elapsed_ms.count() << "\n";
+
+        ReleaseResponse(connection);
+        if (connection->prev) {
+            connection->prev->next = connection->next;
+        } else {
+            connections_ = connection->next;
+        }
+        if (connection->next) {
+            connection->next->prev = connection->prev;
+        }
+        close(connection->socket);
+        delete connection;
+    }
+
+    IoUringRing ring_;
+    AdvancedHeapManager& ahm_;
+    size_t heap_index_;
+    int listen_socket_;
+    std::atomic<size_t>& total_messages_;
+    std::atomic<size_t>& total_bytes_;
+    std::mt19937 rng_;
+    std::uniform_int_distribution<size_t> response_sizes_;
+
+    io_uring_buf_ring* buffer_ring_ = nullptr;
+    uint16_t buffer_ring_tail_ = 0;
+    char* recv_buffers_ = nullptr;
+    size_t slot_size_;
+    char* responses_ = nullptr;
+    int free_slots_[kResponseSlots];
+    size_t free_slot_count_ = 0;
+
+    UringConnection* connections_ = nullptr;
+    bool stopping_ = false;
+};
+
+// Podigne ogranicenje otvorenih fajlova na maksimum (10k+ konekcija).
+void RaiseFileLimit() {
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
 #endif
 }
 
@@ -119,13 +876,159 @@ int main(int argc, char** argv) {
     Options options = ParseArgs(argc, argv);
     AdvancedHeapManager::Config config;
     config.heap_count = 8;
+#ifndef _WIN32
+    if (options.workers == 0) {
+        options.workers = 1;
+    }
+    // Svaki radnik alocira iz svog heap-a.
+    config.heap_count = options.workers;
+#endif
     AdvancedHeapManager ahm(config);
+    if (options.warm_up > 0) {
+        auto warm_start = std::chrono::steady_clock::now();
+        bool warmed = ahm.WarmUp(options.warm_up);
+        double warm_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - warm_start).count();
+        std::cout << "WarmUp " << options.warm_up << " B po heap-u: " << warm_ms << " ms"
+                  << (warmed ? "" : " (delimicno)") << "\n";
+    }
     std::atomic<size_t> total_messages{ 0 };
     std::atomic<size_t> total_bytes{ 0 };
 
 #ifndef _WIN32
-    std::cerr << "Ovaj test server zahteva Windows Winsock.\n";
-    return 1;
+    RaiseFileLimit();
+
+    int listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_socket < 0) {
+        std::cerr << "socket neuspesan.\n";
+        return 1;
+    }
+    int reuse = 1;
+    setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in service{};
+    service.sin_family = AF_INET;
+    service.sin_addr.s_addr = htonl(INADDR_ANY);
+    service.sin_port = htons(options.port);
+
+    if (bind(listen_socket, reinterpret_cast<sockaddr*>(&service), sizeof(service)) != 0) {
+        std::cerr << "bind neuspesan.\n";
+        close(listen_socket);
+        return 1;
+    }
+
+    if (listen(listen_socket, SOMAXCONN) != 0) {
+        std::cerr << "listen neuspesan.\n";
+        close(listen_socket);
+        return 1;
+    }
+
+    std::cout << "Server pokrenut, port " << options.port << ", radnika " << options.workers
+        << (options.use_uring ? " (io_uring)" : " (epoll)") << "\n";
+    if (options.use_uring) {
+        std::cout << "Alokator: AHM (registrovani baferi po radniku)\n";
+    } else {
+        std::cout << "Alokator: " << (options.use_arena ? "AHM arena" : options.use_ahm ? "AHM" : "malloc/free") << "\n";
+    }
+    // Slanje na zatvorenu konekciju vraca gresku umesto SIGPIPE-a.
+    signal(SIGPIPE, SIG_IGN);
+
+    // SIGINT/SIGTERM prima samo glavna nit: radnici nastaju sa blokiranim
+    // signalima, a accept u glavnoj niti se prekida (bez SA_RESTART).
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, nullptr);
+
+    ThreadList threads;
+    if (options.use_uring) {
+        for (size_t i = 0; i < options.workers; ++i) {
+            threads.Add(std::thread([&, i]() {
+                // Prsten pravi nit koja ga koristi (IORING_SETUP_SINGLE_ISSUER).
+                try {
+                    UringWorker worker(ahm, options, i, listen_socket, total_messages, total_bytes);
+                    worker.Run();
+                } catch (const std::exception& error) {
+                    std::cerr << "io_uring radnik " << i << ": " << error.what() << "\n";
+                    g_running.store(false);
+                }
+            }));
+        }
+        // Radnici sami prihvataju konekcije; glavna nit samo ceka signal za gasenje.
+        timespec poll_interval{};
+        poll_interval.tv_nsec = 100 * 1000 * 1000;
+        while (g_running.load()) {
+            if (sigtimedwait(&stop_signals, nullptr, &poll_interval) > 0) {
+                g_running.store(false);
+            }
+        }
+        threads.JoinAll();
+        std::cout << "Server statistika: poruke=" << total_messages.load() << " bajtova=" << total_bytes.load() << "\n";
+        close(listen_socket);
+        return 0;
+    }
+
+    EpollServer server(ahm, options, total_messages, total_bytes);
+    Worker* workers = new Worker[options.workers];
+    for (size_t i = 0; i < options.workers; ++i) {
+        workers[i].heap_index = i;
+        workers[i].epoll_fd = epoll_create1(0);
+        workers[i].rng.seed(static_cast<unsigned int>(i + 1));
+        workers[i].response_sizes = std::uniform_int_distribution<size_t>(1, options.max_message);
+        if (workers[i].epoll_fd < 0) {
+            std::cerr << "epoll_create1 neuspesan.\n";
+            g_running.store(false);
+            break;
+        }
+        threads.Add(std::thread([&server, &workers, i]() { server.Run(workers[i]); }));
+    }
+
+    struct sigaction action{};
+    action.sa_handler = &StopServer;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    pthread_sigmask(SIG_UNBLOCK, &stop_signals, nullptr);
+
+    // Chunk od 4 najveca odgovora, kao na Windows-u: ni veliki baferi ne idu
+    // u AHM posle prve poruke.
+    size_t arena_chunk = 4 * options.max_message;
+    if (arena_chunk < AhmArena::kDefaultChunkBytes) {
+        arena_chunk = AhmArena::kDefaultChunkBytes;
+    }
+    size_t next_worker = 0;
+    while (g_running.load()) {
+        int client_socket = accept4(listen_socket, nullptr, nullptr, SOCK_NONBLOCK);
+        if (client_socket < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            // Npr. EMFILE: ne prekidaj server, sacekaj da se konekcije zatvore.
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        int no_delay = 1;
+        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+        // Konekcije se dele radnicima redom; epoll_ctl je bezbedan iz druge niti.
+        Worker& worker = workers[next_worker++ % options.workers];
+        Connection* connection = new Connection(ahm, worker.heap_index, client_socket, arena_chunk);
+        if (!server.Add(worker, connection)) {
+            close(client_socket);
+            delete connection;
+        }
+    }
+
+    threads.JoinAll();
+    for (size_t i = 0; i < options.workers; ++i) {
+        if (workers[i].epoll_fd >= 0) {
+            close(workers[i].epoll_fd);
+        }
+    }
+    delete[] workers;
+    std::cout << "Server statistika: poruke=" << total_messages.load() << " bajtova=" << total_bytes.load() << "\n";
+
+    close(listen_socket);
+    return 0;
 #else
     WSADATA wsa_data;
     if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
@@ -160,7 +1063,9 @@ int main(int argc, char** argv) {
     }
 
     std::cout << "Server pokrenut, port " << options.port << "\n";
+    std::cout << "Alokator: " << (options.use_arena ? "AHM arena" : options.use_ahm ? "AHM" : "malloc/free") << "\n";
     std::atomic<bool> running{true};
+    size_t next_client = 0;
 
     ThreadList workers;
     while (running.load()) {
@@ -169,7 +1074,9 @@ int main(int argc, char** argv) {
             break;
         }
 
-        workers.Add(std::thread([&, client_socket]() {
+        // Arena svake konekcije uzima chunk-ove iz jednog heap-a, redom.
+        size_t client_heap = next_client++ % ahm.HeapCount();
+        workers.Add(std::thread([&, client_socket, client_heap]() {
             // Za svakog klijenta generisemo nasumicnu duzinu odgovora.
             std::mt19937 rng(static_cast<unsigned int>(GetTickCount()));
             std::uniform_int_distribution<size_t> dist(1, options.max_message);
@@ -177,6 +1084,28 @@ int main(int argc, char** argv) {
             size_t client_bytes = 0;
             auto client_start = std::chrono::steady_clock::now();
 
+            // Chunk od 4 najveca odgovora: obe poruke staju u isti chunk, pa
+            // ni veliki baferi ne idu u AHM posle prve poruke.
+            size_t arena_chunk = 4 * options.max_message;
+            AhmArena arena(ahm, client_heap, arena_chunk > AhmArena::kDefaultChunkBytes ? arena_chunk : AhmArena::kDefaultChunkBytes);
+            auto allocate = [&](size_t size) -> void* {
+                if (options.use_arena) {
+                    return arena.Allocate(size);
+                }
+                return options.use_ahm ? ahm.Malloc(size) : std::malloc(size);
+            };
+            // Sa arenom se pojedinacni baferi ne oslobadjaju (vidi arena.Reset()).
+            auto release = [&](void* ptr) {
+                if (options.use_arena) {
+                    return;
+                }
+                if (options.use_ahm) {
+                    ahm.Free(ptr);
+                } else {
+                    std::free(ptr);
+                }
+            };
+
             while (true) {
                 uint32_t length = 0;
                 if (!RecvAll(client_socket, &length, sizeof(length))) {
@@ -185,16 +1114,12 @@ int main(int argc, char** argv) {
                 length = ntohl(length);
 
                 // Primi poruku.
-                void* recv_buffer = options.use_ahm ? ahm.Malloc(length) : std::malloc(length);
+                void* recv_buffer = allocate(length);
                 if (!recv_buffer) {
                     break;
                 }
                 if (!RecvAll(client_socket, recv_buffer, length)) {
-                    if (options.use_ahm) {
-                        ahm.Free(recv_buffer);
-                    } else {
-                        std::free(recv_buffer);
-                    }
+                    release(recv_buffer);
                     break;
                 }
                 ++client_messages;
@@ -202,13 +1127,9 @@ int main(int argc, char** argv) {
 
                 // Pripremi odgovor nasumicne duzine.
                 size_t response_size = dist(rng);
-                void* send_buffer = options.use_ahm ? ahm.Malloc(response_size) : std::malloc(response_size);
+                void* send_buffer = allocate(response_size);
                 if (!send_buffer) {
-                    if (options.use_ahm) {
-                        ahm.Free(recv_buffer);
-                    } else {
-                        std::free(recv_buffer);
-                    }
+                    release(recv_buffer);
                     break;
                 }
                 std::memset(send_buffer, 0xA5, response_size);
@@ -216,25 +1137,16 @@ int main(int argc, char** argv) {
                 uint32_t response_length = htonl(static_cast<uint32_t>(response_size));
                 if (!SendAll(client_socket, &response_length, sizeof(response_length)) ||
                     !SendAll(client_socket, send_buffer, response_size)) {
-                    if (options.use_ahm) {
-                        ahm.Free(send_buffer);
-                        ahm.Free(recv_buffer);
-                    } else {
-                        std::free(send_buffer);
-                        std::free(recv_buffer);
-                    }
+                    release(send_buffer);
+                    release(recv_buffer);
                     break;
                 }
                 ++client_messages;
                 client_bytes += response_size;
 
-                if (options.use_ahm) {
-                    ahm.Free(send_buffer);
-                    ahm.Free(recv_buffer);
-                } else {
-                    std::free(send_buffer);
-                    std::free(recv_buffer);
-                }
+                release(send_buffer);
+                release(recv_buffer);
+                arena.Reset();
             }
             auto client_end = std::chrono::steady_clock::now();
             total_messages.fetch_add(client_messages, std::memory_order_relaxed);
@@ -0,0 +1,154 @@
+#include "../../ahm/ahm.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+
+// Benchmark rasta bafera poruka kao u parseru koji cita tok: poruka stize u
+// delovima, bafer se povecava (x1.5) kada se napuni, a posle obrade se
+// oslobadja. Poredi Realloc sa Malloc + memcpy + Free i sa std::realloc.
+namespace {
+enum class Mode { kRealloc, kCopy, kMalloc };
+
+struct Options {
+    size_t threads = 1;
+    size_t messages = 2000;
+    size_t max_message = 4 * 1024 * 1024;
+    size_t chunk = 4096;
+    size_t heap_count = 8;
+    Mode mode = Mode::kRealloc;
+};
+
+Options ParseArgs(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            options.threads = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--messages" && i + 1 < argc) {
+            options.messages = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--max-message" && i + 1 < argc) {
+            options.max_message = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--chunk" && i + 1 < argc) {
+            options.chunk = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--heaps" && i + 1 < argc) {
+            options.heap_count = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--copy") {
+            options.mode = Mode::kCopy;
+        } else if (arg == "--malloc") {
+            options.mode = Mode::kMalloc;
+        }
+    }
+    return options;
+}
+
+const char* ModeName(Mode mode) {
+    switch (mode) {
+    case Mode::kRealloc:
+        return "AHM Realloc";
+    case Mode::kCopy:
+        return "AHM Malloc + memcpy + Free";
+    default:
+        return "realloc/free";
+    }
+}
+
+// Povecava bafer na new_capacity bajtova, cuvajuci prvih used bajtova.
+void* Grow(AdvancedHeapManager& ahm, Mode mode, void* buffer, size_t used, size_t new_capacity) {
+    switch (mode) {
+    case Mode::kRealloc:
+        return ahm.Realloc(buffer, new_capacity);
+    case Mode::kCopy: {
+        void* grown = ahm.Malloc(new_capacity);
+        if (grown && buffer) {
+            std::memcpy(grown, buffer, used);
+            ahm.Free(buffer);
+        }
+        return grown;
+    }
+    default:
+        return std::realloc(buffer, new_capacity);
+    }
+}
+}
+
+int main(int argc, char** argv) {
+    Options options = ParseArgs(argc, argv);
+    AdvancedHeapManager::Config config;
+    config.heap_count = options.heap_count;
+    AdvancedHeapManager ahm(config);
+
+    const size_t messages_per_thread = options.messages / options.threads;
+    std::atomic<size_t> total_bytes{0};
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::thread* workers = new std::thread[options.threads];
+
+    for (size_t t = 0; t < options.threads; ++t) {
+        workers[t] = std::thread([&, t]() {
+            std::mt19937_64 rng(t + 1);
+            char* chunk = new char[options.chunk];
+            std::memset(chunk, static_cast<int>('a' + t), options.chunk);
+            size_t bytes = 0;
+
+            for (size_t m = 0; m < messages_per_thread; ++m) {
+                // Velicine poruka su log-uniformne: mnogo malih, poneka velika.
+                double exponent = std::uniform_real_distribution<double>(6.0, std::log2(static_cast<double>(options.max_message)))(rng);
+                size_t length = static_cast<size_t>(std::exp2(exponent));
+
+                size_t capacity = 256;
+                size_t used = 0;
+                char* buffer = static_cast<char*>(Grow(ahm, options.mode, nullptr, 0, capacity));
+                while (buffer && used < length) {
+                    size_t piece = std::min(options.chunk, length - used);
+                    if (used + piece > capacity) {
+                        size_t new_capacity = std::max(capacity + capacity / 2, used + piece);
+                        buffer = static_cast<char*>(Grow(ahm, options.mode, buffer, used, new_capacity));
+                        capacity = new_capacity;
+                        if (!buffer) {
+                            break;
+                        }
+                    }
+                    std::memcpy(buffer + used, chunk, piece);
+                    used += piece;
+                }
+                bytes += used;
+
+                if (options.mode == Mode::kMalloc) {
+                    std::free(buffer);
+                } else {
+                    ahm.Free(buffer);
+                }
+            }
+
+            delete[] chunk;
+            total_bytes.fetch_add(bytes);
+        });
+    }
+
+    for (size_t i = 0; i < options.threads; ++i) {
+        workers[i].join();
+    }
+    delete[] workers;
+
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    std::cout << "Threads: " << options.threads << "\n";
+    std::cout << "Messages: " << options.messages << "\n";
+    std::cout << "Max message: " << options.max_message << "\n";
+    std::cout << "Chunk: " << options.chunk << "\n";
+    std::cout << "Allocator: " << ModeName(options.mode) << "\n";
+    std::cout << "Bytes parsed: " << total_bytes.load() << "\n";
+    std::cout << "Duration (ms): " << duration_ms << "\n";
+
+    return 0;
+}
@@ -1,7 +1,47 @@
 #define WIN32_LEAN_AND_MEAN
 #define _WINSOCK_DEPRECATED_NO_WARNINGS
 
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <pthread.h>
+#include <stdint.h>
+
+// Minimalni sloj nad pthread-om kako bi test ostao isti na Linux-u.
+typedef unsigned long DWORD;
+typedef void* LPVOID;
+typedef pthread_t HANDLE;
+typedef pthread_mutex_t CRITICAL_SECTION;
+#define WINAPI
+#define INFINITE 0
+
+typedef DWORD (*LPTHREAD_START_ROUTINE)(LPVOID);
+
+struct ThreadStart {
+    LPTHREAD_START_ROUTINE routine;
+    LPVOID param;
+};
+
+static void* ThreadTrampoline(void* arg) {
+    ThreadStart start = *static_cast<ThreadStart*>(arg);
+    delete static_cast<ThreadStart*>(arg);
+    start.routine(start.param);
+    return NULL;
+}
+
+static HANDLE CreateThread(void*, size_t, LPTHREAD_START_ROUTINE routine, LPVOID param, DWORD, DWORD*) {
+    pthread_t thread;
+    pthread_create(&thread, NULL, &ThreadTrampoline, new ThreadStart{routine, param});
+    return thread;
+}
+
+static void WaitForSingleObject(HANDLE thread, DWORD) { pthread_join(thread, NULL); }
+static void CloseHandle(HANDLE) {}
+static void InitializeCriticalSection(CRITICAL_SECTION* cs) { pthread_mutex_init(cs, NULL); }
+static void DeleteCriticalSection(CRITICAL_SECTION* cs) { pthread_mutex_destroy(cs); }
+static void EnterCriticalSection(CRITICAL_SECTION* cs) { pthread_mutex_lock(cs); }
+static void LeaveCriticalSection(CRITICAL_SECTION* cs) { pthread_mutex_unlock(cs); }
+#endif
 
 #include <cstdio>
 #include <cstdlib>
@@ -0,0 +1,476 @@
+#include "../../ahm/ahm.h"
+#include "../../ahm/ahm_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <malloc.h>
+
+#ifdef _WIN32
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+// Reprodukuje trag alokacija (Config::trace_path, AHM_TRACE) nad AHM-om ili
+// sistemskim malloc-om:
+//   ahm_replay --trace trag.bin [--malloc] [--heaps n] [--threads n] [--no-touch]
+// Svaka nit iz traga dobija svoju nit reprodukcije i izvrsava svoje dogadjaje
+// redom, bez pauza iz originala. Blok koji oslobadja druga nit ceka dok ga
+// nit vlasnik ne alocira, pa je redosled medju nitima isti kao u tragu.
+// Ispisuje propusnost, vrh RSS-a i fragmentaciju (deo vrha RSS-a iznad vrha
+// zivih bajtova).
+namespace {
+struct Options {
+    std::string trace_path;
+    bool use_ahm = true;
+    size_t heap_count = 8;
+    // Broj niti reprodukcije (0 = koliko ih ima u tragu); niti traga se
+    // rasporedjuju po modulu, uz ocuvan redosled dogadjaja.
+    size_t threads = 0;
+    // Upisuje bajt u svaku stranicu od 4 KiB novog bloka, kao pravi program,
+    // da bi RSS odrazavao zauzetu memoriju.
+    bool touch = true;
+    size_t sample_ms = 1;
+};
+
+Options ParseArgs(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--trace" && i + 1 < argc) {
+            options.trace_path = argv[++i];
+        } else if (arg == "--heaps" && i + 1 < argc) {
+            options.heap_count = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--sample" && i + 1 < argc) {
+            options.sample_ms = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--no-touch") {
+            options.touch = false;
+        } else if (arg == "--malloc") {
+            options.use_ahm = false;
+        }
+    }
+    return options;
+}
+
+enum OpKind : uint8_t {
+    kOpMalloc,
+    kOpCalloc,
+    kOpFree,
+    kOpRealloc,
+};
+
+const uint32_t kNoBlock = UINT32_MAX;
+
+// Dogadjaj reprodukcije. Adrese iz traga se ponavljaju, pa se blokovi
+// oznacavaju rednim brojem alokacije (block); Realloc ima i stari blok.
+struct ReplayOp {
+    OpKind kind;
+    uint8_t alignment_log2;
+    uint32_t block;
+    uint32_t old_block;
+    uint64_t size;
+};
+
+struct Trace {
+    std::vector<std::vector<ReplayOp>> threads;
+    std::vector<uint64_t> block_sizes;
+    std::vector<uint8_t> block_alignments;
+    size_t recorded_threads = 0;
+    uint64_t events = 0;
+    uint64_t operations = 0;
+    // Oslobadjanja blokova alociranih pre pocetka traga (ili mimo njega).
+    uint64_t unknown_frees = 0;
+    uint64_t dropped_events = 0;
+    uint64_t duration_ns = 0;
+    // Zivi bajtovi po redosledu iz traga: vrh i stanje na kraju.
+    uint64_t peak_live_bytes = 0;
+    uint64_t end_live_bytes = 0;
+};
+
+bool ReadRecords(const std::string& path, std::vector<AhmTraceRecord>& records, uint64_t& dropped, std::string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    uint64_t file_size = static_cast<uint64_t>(file.tellg());
+    file.seekg(0, std::ios::beg);
+
+    AhmTraceHeader header{};
+    if (file_size < kTraceHeaderBytes || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, kTraceMagic, sizeof(header.magic)) != 0) {
+        error = path + " is not an AHM trace";
+        return false;
+    }
+    if (header.version != kTraceVersion || header.chunk_bytes < sizeof(AhmTraceRecord)) {
+        error = "unsupported trace version";
+        return false;
+    }
+    dropped = header.dropped_events;
+
+    // Trag koji nije uredno zatvoren nema broj chunk-ova: cita se ceo fajl.
+    uint64_t chunk_count = header.chunk_count;
+    if (chunk_count == 0) {
+        chunk_count = (file_size - kTraceHeaderBytes) / header.chunk_bytes;
+    }
+    std::vector<AhmTraceRecord> chunk(header.chunk_bytes / sizeof(AhmTraceRecord));
+    for (uint64_t c = 0; c < chunk_count; ++c) {
+        file.seekg(static_cast<std::streamoff>(kTraceHeaderBytes + c * header.chunk_bytes));
+        if (!file.read(reinterpret_cast<char*>(chunk.data()), static_cast<std::streamsize>(chunk.size() * sizeof(AhmTraceRecord)))) {
+            break;
+        }
+        for (const AhmTraceRecord& record : chunk) {
+            if (record.Event() == kTraceEmpty) {
+                break;
+            }
+            records.push_back(record);
+        }
+    }
+    return true;
+}
+
+// Pretvara zapise u dogadjaje po nitima reprodukcije: zapisi se sortiraju po
+// vremenu, a svaka adresa dobija nov broj bloka pri svakoj alokaciji.
+bool LoadTrace(const Options& options, Trace& trace, std::string& error) {
+    std::vector<AhmTraceRecord> records;
+    if (!ReadRecords(options.trace_path, records, trace.dropped_events, error)) {
+        return false;
+    }
+    std::stable_sort(records.begin(), records.end(), [](const AhmTraceRecord& a, const AhmTraceRecord& b) {
+        return a.Time() < b.Time();
+    });
+    trace.events = records.size();
+    trace.duration_ns = records.empty() ? 0 : records.back().Time() - records.front().Time();
+
+    std::unordered_map<unsigned, size_t> thread_slots;
+    std::unordered_map<uint64_t, uint32_t> live_blocks;
+    // Stari blok Realloc-a po niti traga, do zapisa sa novom adresom.
+    std::unordered_map<unsigned, uint32_t> realloc_from;
+    uint64_t live_bytes = 0;
+    for (const AhmTraceRecord& record : records) {
+        auto slot = thread_slots.find(record.Thread());
+        if (slot == thread_slots.end()) {
+            size_t index = thread_slots.size();
+            if (options.threads > 0) {
+                index %= options.threads;
+            }
+            slot = thread_slots.emplace(record.Thread(), index).first;
+            if (trace.threads.size() <= index) {
+                trace.threads.resize(index + 1);
+            }
+        }
+        std::vector<ReplayOp>& ops = trace.threads[slot->second];
+
+        ReplayOp op{kOpMalloc, 0, kNoBlock, kNoBlock, record.size};
+        AhmTraceEvent event = record.Event();
+        if (event == kTraceFree || event == kTraceReallocFrom) {
+            auto live = live_blocks.find(record.Address());
+            uint32_t block = kNoBlock;
+            if (live != live_blocks.end()) {
+                block = live->second;
+                live_blocks.erase(live);
+                live_bytes -= trace.block_sizes[block];
+            }
+            if (event == kTraceReallocFrom) {
+                realloc_from[record.Thread()] = block;
+                continue;
+            }
+            if (block == kNoBlock) {
+                ++trace.unknown_frees;
+                continue;
+            }
+            op.kind = kOpFree;
+            op.block = block;
+        } else if (event == kTraceMalloc || event == kTraceCalloc || event == kTraceRealloc) {
+            op.kind = event == kTraceCalloc ? kOpCalloc : kOpMalloc;
+            op.alignment_log2 = static_cast<uint8_t>(record.AlignmentLog2());
+            if (event == kTraceRealloc) {
+                auto from = realloc_from.find(record.Thread());
+                if (from != realloc_from.end() && from->second != kNoBlock) {
+                    op.kind = kOpRealloc;
+                    op.old_block = from->second;
+                }
+                if (from != realloc_from.end()) {
+                    realloc_from.erase(from);
+                }
+            }
+            if (trace.block_sizes.size() >= kNoBlock) {
+                error = "trace has too many blocks";
+                return false;
+            }
+            op.block = static_cast<uint32_t>(trace.block_sizes.size());
+            trace.block_sizes.push_back(record.size);
+            trace.block_alignments.push_back(op.alignment_log2);
+            live_blocks[record.Address()] = op.block;
+            live_bytes += record.size;
+            trace.peak_live_bytes = std::max(trace.peak_live_bytes, live_bytes);
+        } else {
+            continue;
+        }
+        ops.push_back(op);
+        ++trace.operations;
+    }
+    trace.recorded_threads = thread_slots.size();
+    trace.end_live_bytes = live_bytes;
+    return true;
+}
+
+// Rezidentna memorija procesa u bajtovima.
+size_t ResidentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.WorkingSetSize;
+#else
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    statm >> total_pages >> resident_pages;
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+double Mebibytes(double bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+class Replayer {
+public:
+    Replayer(const Trace& trace, const Options& options, AdvancedHeapManager* ahm)
+        : trace_(trace),
+          options_(options),
+          ahm_(ahm),
+          blocks_(new std::atomic<void*>[trace.block_sizes.size()]()) {}
+
+    ~Replayer() {
+        // Blokovi zivi na kraju traga se oslobadjaju van merenja.
+        for (size_t block = 0; block < trace_.block_sizes.size(); ++block) {
+            void* ptr = blocks_[block].load(std::memory_order_relaxed);
+            if (ptr && ptr != Failed()) {
+                Release(static_cast<uint32_t>(block), ptr);
+            }
+        }
+    }
+
+    void Run(size_t thread_index) {
+        for (const ReplayOp& op : trace_.threads[thread_index]) {
+            switch (op.kind) {
+            case kOpMalloc:
+            case kOpCalloc:
+                Store(op.block, Allocate(op));
+                break;
+            case kOpFree: {
+                void* ptr = Take(op.block);
+                if (ptr != Failed()) {
+                    Release(op.block, ptr);
+                }
+                break;
+            }
+            case kOpRealloc: {
+                void* ptr = Take(op.old_block);
+                if (ptr == Failed()) {
+                    Store(op.block, Allocate(op));
+                    break;
+                }
+                void* moved = Reallocate(op.old_block, ptr, op.size);
+                if (!moved) {
+                    // Neuspeo realloc ostavlja stari blok; u tragu ga vise nema.
+                    Release(op.old_block, ptr);
+                }
+                Store(op.block, moved);
+                break;
+            }
+            }
+        }
+    }
+
+private:
+    // Oznaka bloka cija alokacija nije uspela (njegovo oslobadjanje se preskace).
+    static void* Failed() {
+        return reinterpret_cast<void*>(static_cast<uintptr_t>(1));
+    }
+
+    void* Allocate(const ReplayOp& op) {
+        size_t size = static_cast<size_t>(op.size);
+        size_t alignment = static_cast<size_t>(1) << op.alignment_log2;
+        bool aligned = op.alignment_log2 > 4;
+        if (ahm_) {
+            if (op.kind == kOpCalloc) {
+                return ahm_->Calloc(1, size);
+            }
+            return aligned ? ahm_->MallocAligned(size, alignment) : ahm_->Malloc(size);
+        }
+        if (op.kind == kOpCalloc) {
+            return std::calloc(1, size);
+        }
+        if (!aligned) {
+            return std::malloc(size);
+        }
+#ifdef _WIN32
+        return _aligned_malloc(size, alignment);
+#else
+        void* ptr = nullptr;
+        return posix_memalign(&ptr, alignment, size) == 0 ? ptr : nullptr;
+#endif
+    }
+
+    void* Reallocate(uint32_t old_block, void* ptr, uint64_t size) {
+        if (ahm_) {
+            return ahm_->Realloc(ptr, static_cast<size_t>(size));
+        }
+#ifdef _WIN32
+        if (trace_.block_alignments[old_block] > 4) {
+            return _aligned_realloc(ptr, static_cast<size_t>(size), static_cast<size_t>(1) << trace_.block_alignments[old_block]);
+        }
+#else
+        (void)old_block;
+#endif
+        return std::realloc(ptr, static_cast<size_t>(size));
+    }
+
+    void Release(uint32_t block, void* ptr) {
+        if (ahm_) {
+            ahm_->Free(ptr);
+            return;
+        }
+#ifdef _WIN32
+        if (trace_.block_alignments[block] > 4) {
+            _aligned_free(ptr);
+            return;
+        }
+#else
+        (void)block;
+#endif
+        std::free(ptr);
+    }
+
+    void Store(uint32_t block, void* ptr) {
+        if (!ptr) {
+            blocks_[block].store(Failed(), std::memory_order_release);
+            return;
+        }
+        if (options_.touch) {
+            size_t size = static_cast<size_t>(trace_.block_sizes[block]);
+            unsigned char* bytes = static_cast<unsigned char*>(ptr);
+            for (size_t offset = 0; offset < size; offset += 4096) {
+                bytes[offset] = 1;
+            }
+        }
+        blocks_[block].store(ptr, std::memory_order_release);
+    }
+
+    // Ceka da nit koja alocira blok to i uradi (u tragu je alokacija ranija).
+    void* Take(uint32_t block) {
+        void* ptr = blocks_[block].load(std::memory_order_acquire);
+        while (!ptr) {
+            std::this_thread::yield();
+            ptr = blocks_[block].load(std::memory_order_acquire);
+        }
+        blocks_[block].store(nullptr, std::memory_order_relaxed);
+        return ptr;
+    }
+
+    const Trace& trace_;
+    const Options& options_;
+    AdvancedHeapManager* ahm_;
+    std::unique_ptr<std::atomic<void*>[]> blocks_;
+};
+}
+
+int main(int argc, char** argv) {
+    Options options = ParseArgs(argc, argv);
+    if (options.trace_path.empty()) {
+        std::cerr << "Usage: ahm_replay --trace <file> [--malloc] [--heaps n] [--threads n] [--no-touch] [--sample ms]\n";
+        return 1;
+    }
+
+    Trace trace;
+    std::string error;
+    if (!LoadTrace(options, trace, error)) {
+        std::cerr << "ahm_replay: " << error << "\n";
+        return 1;
+    }
+
+    std::unique_ptr<AdvancedHeapManager> ahm;
+    if (options.use_ahm) {
+        AdvancedHeapManager::Config config;
+        config.heap_count = options.heap_count;
+        ahm.reset(new AdvancedHeapManager(config));
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Trace: " << options.trace_path << "\n";
+    std::cout << "Events: " << trace.events << " (replayed: " << trace.operations
+              << ", unknown frees: " << trace.unknown_frees << ", dropped while recording: " << trace.dropped_events << ")\n";
+    std::cout << "Recorded threads: " << trace.recorded_threads << ", replay threads: " << trace.threads.size() << "\n";
+    std::cout << "Recorded duration (ms): " << static_cast<double>(trace.duration_ns) / 1e6 << "\n";
+    std::cout << "Allocator: " << (options.use_ahm ? "AHM" : "malloc/free") << "\n";
+
+    {
+        Replayer replayer(trace, options, ahm.get());
+        // Slobodna memorija od ucitavanja traga ne sme da umanji rast RSS-a malloc-a.
+#if !defined(_WIN32) && defined(__GLIBC__)
+        malloc_trim(0);
+#endif
+        size_t baseline = ResidentBytes();
+
+        std::atomic<bool> done{false};
+        size_t peak_rss = 0;
+        auto sample = [&]() {
+            size_t resident = ResidentBytes();
+            peak_rss = std::max(peak_rss, resident > baseline ? resident - baseline : 0);
+        };
+        std::thread sampler([&]() {
+            while (!done.load(std::memory_order_acquire)) {
+                sample();
+                std::this_thread::sleep_for(std::chrono::milliseconds(options.sample_ms));
+            }
+        });
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < trace.threads.size(); ++t) {
+            workers.emplace_back([&replayer, t]() { replayer.Run(t); });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        auto end = std::chrono::steady_clock::now();
+        done.store(true, std::memory_order_release);
+        sampler.join();
+        sample();
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        std::cout << "Replay time (ms): " << seconds * 1000.0 << "\n";
+        std::cout << "Throughput (Mops/s): " << (seconds > 0 ? static_cast<double>(trace.operations) / seconds / 1e6 : 0.0) << "\n";
+        std::cout << "Peak live bytes (MiB): " << Mebibytes(static_cast<double>(trace.peak_live_bytes)) << "\n";
+        std::cout << "Peak RSS over baseline (MiB): " << Mebibytes(static_cast<double>(peak_rss)) << "\n";
+        // Vrhovi se ne poklapaju nuzno u vremenu: RSS posle vrha zivih bajtova
+        // ne pada bez vracanja memorije OS-u, pa se porede vrh sa vrhom.
+        double fragmentation = 0.0;
+        if (peak_rss > trace.peak_live_bytes) {
+            fragmentation = 100.0 * (1.0 - static_cast<double>(trace.peak_live_bytes) / static_cast<double>(peak_rss));
+        }
+        std::cout << "Fragmentation (1 - peak live / peak RSS, %): " << fragmentation << "\n";
+        std::cout << "Live bytes at end (MiB): " << Mebibytes(static_cast<double>(trace.end_live_bytes)) << "\n";
+    }
+    return 0;
+}